@@ -37,6 +37,7 @@
 #include "util.h"
 #include "vcp.h"
 #include "hdlc.h"
+#include "txq.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -225,10 +226,16 @@ int main(void)
     VCPEnumerate();
 #endif
 
+    // Start timing interrupt handlers (if enabled) before they're running
+    IsrCyclesInit();
+
     // Start sync serial handler
     log_info("Starting synchronous serial handler");
     SyncStartup(&htim2);
 
+    // Time the CRC kernels (if enabled)
+    CrcBenchmarkLog();
+
     // Done!
     log_info("Startup complete");
     VCPWriteDebug1("Startup complete");
@@ -246,9 +253,13 @@ int main(void)
     while (1)
     {
         // Processing callbacks
+        SyncEventCallback();
         RxMessageCallback();
+        SyncClockCallback();
         HdlcCallback();
         VCPRxCallback();
+        TxqCallback();
+        VCPStatusCallback();
         VCPTxCallback();
         SerialCallback(&huart2);
 // LED callbacks
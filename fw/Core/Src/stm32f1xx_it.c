@@ -23,6 +23,10 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "fault.h"
+#include "config.h"
+#include "util.h"
+#include "sync.h"
+#include "vcp.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -64,6 +68,10 @@ extern DMA_HandleTypeDef hdma_usart2_tx;
 extern UART_HandleTypeDef huart1;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
+extern DMA_HandleTypeDef hdma_tim2_up;
+extern DMA_HandleTypeDef hdma_tim2_ch3;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_tim3_up;
 
 /* USER CODE END EV */
 
@@ -288,7 +296,15 @@ void USB_LP_CAN1_RX0_IRQHandler(void)
 void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
-
+  ISR_CYCLES_START();
+  // Fast path for the line clock update that skips the generic HAL dispatch, HAL still handles anything else
+  if ((TIM2->SR & TIM_SR_UIF) && (TIM2->DIER & TIM_DIER_UIE))
+  {
+    TIM2->SR = ~(uint32_t)TIM_SR_UIF;
+    SyncTimerCallback();
+    ISR_CYCLES_END(ISR_CYC_TIM2);
+    return;
+  }
   /* USER CODE END TIM2_IRQn 0 */
   HAL_TIM_IRQHandler(&htim2);
   /* USER CODE BEGIN TIM2_IRQn 1 */
@@ -302,11 +318,12 @@ void TIM2_IRQHandler(void)
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
-
+  // RX bytes are moved by DMA, so this only runs for the IDLE line, errors and TX
+  ISR_CYCLES_START();
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
-
+  ISR_CYCLES_END(ISR_CYC_USART1);
   /* USER CODE END USART1_IRQn 1 */
 }
 
@@ -316,14 +333,74 @@ void USART1_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  ISR_CYCLES_START();
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
-
+  ISR_CYCLES_END(ISR_CYC_USART2);
   /* USER CODE END USART2_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
 
+#ifdef SYNC_TX_DMA
+/**
+  * @brief This function handles DMA1 channel1 global interrupt (TIM2_CH3 TX waveform).
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+  ISR_CYCLES_START();
+  HAL_DMA_IRQHandler(&hdma_tim2_ch3);
+  ISR_CYCLES_END(ISR_CYC_SYNC_TX_DMA);
+}
+#endif
+
+#ifdef SYNC_RX_DMA
+/**
+  * @brief This function handles DMA1 channel2 global interrupt (TIM2_UP RXD capture).
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+  ISR_CYCLES_START();
+  HAL_DMA_IRQHandler(&hdma_tim2_up);
+  ISR_CYCLES_END(ISR_CYC_SYNC_RX_DMA);
+}
+#elif defined(SYNC_RX_SPI)
+/**
+  * @brief This function handles DMA1 channel2 global interrupt (SPI1_RX line bytes).
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+  ISR_CYCLES_START();
+  HAL_DMA_IRQHandler(&hdma_spi1_rx);
+  ISR_CYCLES_END(ISR_CYC_SYNC_RX_DMA);
+}
+#endif
+
+#ifdef SYNC_RX_OVERSAMPLE
+/**
+  * @brief This function handles DMA1 channel3 global interrupt (TIM3_UP oversampled RXD capture).
+  */
+void DMA1_Channel3_IRQHandler(void)
+{
+  ISR_CYCLES_START();
+  HAL_DMA_IRQHandler(&hdma_tim3_up);
+  ISR_CYCLES_END(ISR_CYC_SYNC_RX_DMA);
+}
+#endif
+
+#ifdef SYNC_EXT_CLOCK
+/**
+  * @brief This function handles EXTI line3 interrupt (RXCLK external clock edges).
+  */
+void EXTI3_IRQHandler(void)
+{
+  ISR_CYCLES_START();
+  // Line 3 is only used by RXCLK, so clear it and go straight to the sync engine
+  EXTI->PR = DCE_RXCLK_Pin;
+  SyncClockEdge();
+  ISR_CYCLES_END(ISR_CYC_EXTI3);
+}
+#endif
+
 /* USER CODE END 1 */
@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file           : bench_crc.c
+  * @brief          : CRC kernel check & cycles per byte benchmark
+  *
+  * crc.c is built with CRC_BENCHMARK so all its kernels are in, the way the
+  * firmware's startup benchmark builds it. Every kernel is first checked
+  * against a bitwise CRC-16/X.25 on random data of random length, from a
+  * random running CRC and split into random pieces the way streaming callers
+  * feed it. It also has to give the standard check value, and the residue
+  * over a frame with its FCS. Then each kernel is timed at a few lengths.
+  *
+  * On x86 the time is in TSC cycles, which tick at the nominal clock rather
+  * than the core's current one, elsewhere it's in nanoseconds. Either way
+  * it's for comparing the kernels with each other, the firmware's own
+  * benchmark (CRC_BENCHMARK in config.h) gives the cycles on the target.
+  *
+  * Usage: bench_crc [number of random checks]
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "crc.h"
+#include "test.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT  "cycles"
+#else
+#define BENCH_UNIT  "ns"
+#endif
+
+TEST_GLOBALS
+
+// Lengths the kernels are timed at, and about how many bytes go through each timed run
+static const uint16_t benchLens[] = { 16U, 64U, 256U, HDLC_MAX_FRAME_SIZE_BYTES, 4096U };
+#define BENCH_RUN_BYTES     (1UL << 20)
+#define BENCH_RUNS          8U
+
+#define CHECK_LEN_MAX       1024U
+
+uint8_t data[4096];
+
+/**
+ * @brief Bitwise CRC-16/X.25, independent of the tables in crc.c
+*/
+static uint16_t crcBitwise(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            crc = (crc & 0x1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Free running count to time with
+*/
+static uint64_t benchCount()
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+    #else
+    return (uint64_t)(testNow() * 1e9);
+    #endif
+}
+
+/**
+ * @brief Check every kernel against the bitwise CRC on random data, lengths & starting CRCs
+*/
+static void checkKernels(unsigned long checks)
+{
+    static const uint8_t checkStr[] = "123456789";
+    uint32_t rng = 0xC5C0FFEEU;
+
+    for (uint8_t k = 0; k < CRC_KERNEL_COUNT; k++)
+    {
+        // CRC-16/X.25 check value
+        uint16_t fcs = CrcFinal(CrcUpdateKernel(k, CrcStart(), checkStr, 9U));
+        CHECK(fcs == 0x906E, "%s kernel gave 0x%04X for the check string", crcKernelNames[k], fcs);
+    }
+
+    for (unsigned long n = 0; n < checks && testFailures == 0; n++)
+    {
+        uint16_t len = testRandRange(&rng, 0U, CHECK_LEN_MAX);
+        uint16_t init = (n & 0x1) ? CrcStart() : testRand(&rng);
+        for (uint16_t i = 0; i < len; i++)
+        {
+            data[i] = testRand(&rng);
+        }
+        uint16_t expected = crcBitwise(init, data, len);
+        uint16_t split = len ? testRandRange(&rng, 0U, len) : 0U;
+
+        for (uint8_t k = 0; k < CRC_KERNEL_COUNT; k++)
+        {
+            uint16_t crc = CrcUpdateKernel(k, init, data, len);
+            CHECK(crc == expected, "%s kernel gave 0x%04X for %u bytes from 0x%04X, expected 0x%04X",
+                crcKernelNames[k], crc, len, init, expected);
+            crc = CrcUpdateKernel(k, CrcUpdateKernel(k, init, data, split), data + split, len - split);
+            CHECK(crc == expected, "%s kernel gave 0x%04X for %u bytes split at %u, expected 0x%04X",
+                crcKernelNames[k], crc, len, split, expected);
+        }
+
+        // A frame followed by its FCS leaves the residue
+        if (len >= 2U && init == CrcStart())
+        {
+            uint16_t fcs = CrcFinal(crcBitwise(CrcStart(), data, len - 2U));
+            data[len - 2U] = fcs & 0xFF;
+            data[len - 1U] = fcs >> 8;
+            for (uint8_t k = 0; k < CRC_KERNEL_COUNT; k++)
+            {
+                uint16_t crc = CrcUpdateKernel(k, CrcStart(), data, len);
+                CHECK(crc == CRC16_X25_RESIDUE, "%s kernel gave 0x%04X over a %u byte frame & FCS",
+                    crcKernelNames[k], crc, len);
+            }
+        }
+    }
+    if (testFailures == 0)
+    {
+        printf("%lu random blocks up to %u bytes: every kernel matches the bitwise CRC\n", checks, CHECK_LEN_MAX);
+    }
+}
+
+/**
+ * @brief Time a kernel at a length, the best of several runs so the host's interrupts & scheduling don't count
+ * @return time per byte
+*/
+static double benchKernel(uint8_t kernel, uint16_t len)
+{
+    unsigned long reps = BENCH_RUN_BYTES / len;
+    uint64_t best = UINT64_MAX;
+    volatile uint16_t sink = 0;
+    for (uint8_t run = 0; run < BENCH_RUNS; run++)
+    {
+        uint16_t crc = CrcStart();
+        uint64_t start = benchCount();
+        for (unsigned long r = 0; r < reps; r++)
+        {
+            crc = CrcUpdateKernel(kernel, crc, data, len);
+        }
+        uint64_t taken = benchCount() - start;
+        sink = crc;
+        if (taken < best)
+        {
+            best = taken;
+        }
+    }
+    (void)sink;
+    return (double)best / ((double)reps * len);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long checks = testArgCount(argc, argv, 100000UL);
+    uint32_t rng = 0xBE4C4U;
+
+    CrcInit();
+    checkKernels(checks);
+
+    for (uint16_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = testRand(&rng);
+    }
+    printf("%s per byte:\n%-12s", BENCH_UNIT, "");
+    for (uint8_t l = 0; l < sizeof(benchLens) / sizeof(benchLens[0]); l++)
+    {
+        printf(" %7u B", benchLens[l]);
+    }
+    printf("\n");
+    for (uint8_t k = 0; k < CRC_KERNEL_COUNT; k++)
+    {
+        printf("%-12s", crcKernelNames[k]);
+        for (uint8_t l = 0; l < sizeof(benchLens) / sizeof(benchLens[0]); l++)
+        {
+            printf(" %9.2f", benchKernel(k, benchLens[l]));
+        }
+        printf("%s\n", k == CRC_KERNEL ? "  (selected)" : "");
+    }
+
+    return testResult("crc");
+}
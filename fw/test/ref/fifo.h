@@ -2,6 +2,9 @@
   ******************************************************************************
   * @file           : fifo.h
   * @brief          : Header for fifo.c file
+  *
+  * The FIFO the firmware used before Ring_t, kept for the host ring
+  * benchmark. Only the log.h include has been dropped.
   ******************************************************************************
   */
 
@@ -15,8 +18,6 @@ extern "C" {
 
 #include <stdint.h>
 
-#include "log.h"
-
 typedef struct {
     uint8_t * const buffer;
     int size;
@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file           : sync_rx_old.c
+  * @brief          : The bit at a time RX deframer from before the table driven
+  *                   one, kept as the reference for test_deframe
+  *
+  * RxBits() destuffed a bit per timer interrupt and pushed bytes into a FIFO,
+  * escaping data 0x7E & 0x7D and marking frame ends with flags. The main loop
+  * split the FIFO on the flags, and HDLCParseMsg() unescaped each frame.
+  * RxBits() is copied as it was, minus the logging & the RX delay. The
+  * splitter & unescape are folded into OldRxMessageCallback(), with 16 bit
+  * lengths since the old 8 bit ones couldn't hold a full size frame.
+  *
+  * OldSyncReset() also clears the ones counter, stuffed bit position and
+  * frame in progress flag, which the old SyncReset() left over from before
+  * an abort. The new deframer clears them, and without that the two would
+  * only agree again after a random number of frames.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "sync_rx_old.h"
+
+#include "fifo.h"
+#include "sync.h"
+
+#define HDLC_ESCAPE_CODE    0x7D    // This is used to escape bytes
+#define HDLC_ESCAPE_7E      0x5E    // Follows the escape code to escape a 0x7E
+#define HDLC_ESCAPE_7D      0x5D    // Follows the escape code to escape a 0x7D
+
+// Room for a full size frame with every byte escaped
+#define OLD_RX_BUF_LEN      (SYNC_RX_FRAME_MAX * 4)
+
+OldRxFrameFn_t oldRxFrame = NULL;
+unsigned long oldRxAborts = 0;
+
+uint8_t oldRxBuf[OLD_RX_BUF_LEN];
+FIFO_t oldRxFifo = {
+    .buffer = oldRxBuf,
+    .head = 0,
+    .tail = 0,
+    .maxlen = OLD_RX_BUF_LEN
+};
+
+static enum RxState oldRxState = SEARCH;
+static uint8_t rxCurrentByte = 0;
+static uint8_t rxBitCounter = 0;
+static uint8_t byteStuffed = 255;
+static uint8_t rxOnesCounter = 0;
+static bool rxMsgInProgress = false;
+
+static uint8_t rxCurMsg[SYNC_RX_FRAME_MAX];
+static uint16_t rxCurPos = 0;
+static bool rxMsgStarted = false;
+static bool rxMsgComplete = false;
+static bool rxEscaped = false;
+
+/**
+ * @brief Reset RX sync state & clear buffers
+*/
+void OldSyncReset()
+{
+    rxCurrentByte = 0;
+    rxBitCounter = 0;
+    byteStuffed = 255;
+    rxOnesCounter = 0;
+    rxMsgInProgress = false;
+    oldRxState = SEARCH;
+    rxCurPos = 0;
+    rxMsgStarted = false;
+    rxMsgComplete = false;
+    rxEscaped = false;
+    FifoClear(&oldRxFifo);
+}
+
+/**
+ * @brief Split the FIFO on flags and hand each unescaped frame to oldRxFrame
+*/
+void OldRxMessageCallback()
+{
+    // Do nothing without sync
+    if (oldRxState != SYNCED) {
+        FifoClear(&oldRxFifo);
+        return;
+    }
+
+    uint8_t newByte = 0;
+    while (!rxMsgComplete && !FifoPop(&oldRxFifo, &newByte))
+    {
+        // Check for two repeating sync words which delineate
+        if (newByte == HDLC_SYNC_WORD)
+        {
+            if (!rxMsgStarted) {
+                rxMsgStarted = true;
+            }
+            else
+            {
+                rxMsgComplete = true;
+            }
+        }
+        else if (rxMsgStarted)
+        {
+            if (newByte == HDLC_ESCAPE_CODE)
+            {
+                rxEscaped = true;
+                continue;
+            }
+            if (rxEscaped)
+            {
+                newByte = (newByte == HDLC_ESCAPE_7E) ? 0x7E : 0x7D;
+                rxEscaped = false;
+            }
+            if (rxCurPos < SYNC_RX_FRAME_MAX)
+            {
+                rxCurMsg[rxCurPos] = newByte;
+            }
+            rxCurPos++;
+        }
+    }
+    // Process the complete message
+    if (rxMsgComplete)
+    {
+        if (rxCurPos > 1 && rxCurPos <= SYNC_RX_FRAME_MAX && oldRxFrame != NULL)
+        {
+            oldRxFrame(rxCurMsg, rxCurPos);
+        }
+        rxCurPos = 0;
+        rxMsgStarted = false;
+        rxMsgComplete = false;
+        rxEscaped = false;
+    }
+}
+
+/**
+ * @brief Process one bit from the line, as RxBits() did on each rising TX clock edge
+ * @param rxd the received bit
+*/
+void OldRxBit(bool rxd)
+{
+    // Shift the latest RX bit into the byte buffer (from the left since we receive bits LSB-first)
+    rxCurrentByte = (rxCurrentByte >> 1) | (rxd << 7);
+    // Do different things depending on state
+    switch (oldRxState)
+    {
+        // searching for the HDLC sync frame
+        case SEARCH:
+            // Check what's currently in there
+            if (rxCurrentByte == HDLC_SYNC_WORD)
+            {
+                // Switch state to synced and reset the current byte
+                oldRxState = SYNCED;
+                rxCurrentByte = 0;
+                rxBitCounter = 0;
+            }
+            break;
+
+        // If we're synced, process bits & bytes like normal
+        case SYNCED:
+            // If we've received 5 1s and the next bit is 0, that's a stuffed bit and we should ignore
+            if (rxOnesCounter == 5 && rxd == 0)
+            {
+                // note the location of the stuffed bit (important to differentiate a flag below)
+                byteStuffed = rxBitCounter;
+                // Reset the counter
+                rxOnesCounter = 0;
+                // shift over 1 (dropping the last bit received) and dont increment the bit counter
+                rxCurrentByte <<= 1;
+            }
+            // If we've received 6 1s and the next bit is also a 1, that can't happen normally and we should drop sync
+            else if (rxOnesCounter == 6 && rxd == 1)
+            {
+                oldRxAborts++;
+                OldSyncReset();
+            }
+            else
+            {
+                // Increment the ones counter if needed
+                if (rxd) { rxOnesCounter += 1; } else { rxOnesCounter = 0; }
+
+                // Increment the bit counter
+                rxBitCounter++;
+                // If we've received 8 bits, push the byte to the Fifo and reset
+                if (rxBitCounter == 8)
+                {
+                    if (rxCurrentByte == HDLC_SYNC_WORD) {
+                        // If we got a sync word, check to see if there was a message being sent
+                        if (rxMsgInProgress)
+                        {
+                            // If the byte was stuffed at position 6, it's not actually a sync word so escape it
+                            if (byteStuffed == 6)
+                            {
+                                FifoPush(&oldRxFifo, HDLC_ESCAPE_CODE);
+                                FifoPush(&oldRxFifo, HDLC_ESCAPE_7E);
+                            }
+                            else
+                            {
+                                // Message is done
+                                rxMsgInProgress = false;
+                                // Append tailing sync word so RxCallback can find the end
+                                FifoPush(&oldRxFifo, HDLC_SYNC_WORD);
+                            }
+                        }
+                    }
+                    // If the byte isn't a sync word, put it in the fifo
+                    else
+                    {
+                        // message now in progress
+                        if (!rxMsgInProgress)
+                        {
+                            // Set flag
+                            rxMsgInProgress = true;
+                            // Push starting sync word so RxCallback can find the start
+                            FifoPush(&oldRxFifo, HDLC_SYNC_WORD);
+                        }
+                        // Escape 0x7D if it comes up
+                        if (rxCurrentByte == 0x7D)
+                        {
+                            FifoPush(&oldRxFifo, HDLC_ESCAPE_CODE);
+                            FifoPush(&oldRxFifo, HDLC_ESCAPE_7D);
+                        }
+                        else
+                        {
+                            FifoPush(&oldRxFifo, rxCurrentByte);
+                        }
+                    }
+                    // Reset everything
+                    byteStuffed = 255;
+                    rxCurrentByte = 0;
+                    rxBitCounter = 0;
+                }
+            }
+            break;
+
+        default:
+            oldRxState = SEARCH;
+            OldSyncReset();
+            break;
+    }
+}
@@ -0,0 +1,26 @@
+/**
+  ******************************************************************************
+  * @file           : sync_rx_old.h
+  * @brief          : Header for sync_rx_old.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SYNC_RX_OLD_H
+#define __SYNC_RX_OLD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Called with each unescaped frame (address through FCS)
+typedef void (*OldRxFrameFn_t)(const uint8_t *data, uint16_t len);
+extern OldRxFrameFn_t oldRxFrame;
+
+// Number of 7 ones aborts
+extern unsigned long oldRxAborts;
+
+void OldSyncReset();
+void OldRxBit(bool rxd);
+void OldRxMessageCallback();
+
+#endif
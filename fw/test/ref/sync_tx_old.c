@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : sync_tx_old.c
+  * @brief          : The TX frame path from before the FCS was fused into the
+  *                   bit stuffing, kept as the reference for test_tx_frame
+  *
+  * hdlcSendBuf() ran Crc16() over the frame and appended the FCS in the TX
+  * buffer's tail room, then SyncAddTxFrame() stuffed the whole lot into the
+  * ring. Both are copied as they were, on a ring of their own.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "sync_tx_old.h"
+
+#include "bitstuff.h"
+#include "crc.h"
+
+#define HDLC_SYNC_WORD      0x7E
+#define low(x)  ((x) & 0xFF)
+#define high(x) (((x)>>8) & 0xFF)
+
+uint32_t oldTxRing[OLD_TX_RING_WORDS];
+volatile uint16_t oldTxHead = 0;
+volatile uint16_t oldTxTail = 0;
+
+static inline uint16_t txRingFree(uint16_t head)
+{
+    return (oldTxTail - head - 1) & (OLD_TX_RING_BITS - 1);
+}
+
+static inline void txRingPut(uint16_t *head, uint8_t bits, uint8_t count)
+{
+    uint16_t word = *head >> 5;
+    uint8_t shift = *head & 31;
+    // Keep the bits already written to this word, anything above them is stale
+    oldTxRing[word] = (oldTxRing[word] & ((1UL << shift) - 1)) | ((uint32_t)bits << shift);
+    if (shift + count > 32)
+    {
+        oldTxRing[(word + 1) & (OLD_TX_RING_WORDS - 1)] = (uint32_t)bits >> (32 - shift);
+    }
+    *head = (*head + count) & (OLD_TX_RING_BITS - 1);
+}
+
+static inline void txRingCommit(uint16_t head)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    oldTxHead = head;
+}
+
+static bool oldAddTxFrame(const uint8_t *data, uint16_t len)
+{
+    uint16_t head = oldTxHead;
+    // Each nibble can grow by at most one stuffed bit, plus the closing flag
+    if (txRingFree(head) < (uint32_t)len * 10U + 8U)
+    {
+        return false;
+    }
+    // Frames always follow a flag, which ends in a 0
+    uint8_t ones = 0;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        const StuffEntry_t *lo = &stuffTable[ones][data[i] & 0xF];
+        txRingPut(&head, lo->bits, lo->count);
+        const StuffEntry_t *hi = &stuffTable[lo->ones][data[i] >> 4];
+        txRingPut(&head, hi->bits, hi->count);
+        ones = hi->ones;
+    }
+    txRingPut(&head, HDLC_SYNC_WORD, 8);
+    txRingCommit(head);
+    return true;
+}
+
+/**
+ * @brief Send a frame the old way
+ * @param *data frame bytes, with 2 bytes of room after them for the FCS
+ * @param len number of frame bytes
+ * @return true on success, false if the ring is out of space
+*/
+bool OldSendFrame(uint8_t *data, uint16_t len)
+{
+    // Calculate FCS of message
+    uint16_t fcs = Crc16(data, len);
+    // Append
+    data[len] = low(fcs);
+    data[len + 1] = high(fcs);
+    return oldAddTxFrame(data, len + 2U);
+}
@@ -0,0 +1,25 @@
+/**
+  ******************************************************************************
+  * @file           : sync_tx_old.h
+  * @brief          : Header for sync_tx_old.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SYNC_TX_OLD_H
+#define __SYNC_TX_OLD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Same size as the firmware's TX ring
+#define OLD_TX_RING_WORDS   512U
+#define OLD_TX_RING_BITS    (OLD_TX_RING_WORDS * 32U)
+
+extern uint32_t oldTxRing[OLD_TX_RING_WORDS];
+extern volatile uint16_t oldTxHead;
+extern volatile uint16_t oldTxTail;
+
+bool OldSendFrame(uint8_t *data, uint16_t len);
+
+#endif
@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file           : stm32f1xx_hal.h
+  * @brief          : Host stand-in for the STM32F1 HAL, for the host tests
+  *
+  * Just enough of the HAL types, registers & calls for sync.c (and the headers
+  * it pulls in) to build on the host. Peripherals are plain structs the tests
+  * can poke at, and the HAL calls do nothing. HAL_GetTick() is supplied by
+  * the test harness, so tests control time.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+/* Peripheral registers ------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t CRL, CRH, IDR, ODR, BSRR, BRR, LCKR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR, CCR1, CCR2, CCR3, CCR4;
+} TIM_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR, CNDTR, CPAR, CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    volatile uint32_t ISR, IFCR;
+} DMA_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR, CFGR, CIR, APB2RSTR, APB1RSTR, AHBENR, APB2ENR, APB1ENR, BDCR, CSR;
+} RCC_TypeDef;
+
+typedef struct {
+    volatile uint32_t EVCR, MAPR;
+} AFIO_TypeDef;
+
+extern GPIO_TypeDef hostGpioA, hostGpioB, hostGpioC;
+extern TIM_TypeDef hostTim2, hostTim3;
+extern DMA_Channel_TypeDef hostDma1Channel2, hostDma1Channel3;
+extern DMA_TypeDef hostDma1;
+extern RCC_TypeDef hostRcc;
+extern AFIO_TypeDef hostAfio;
+
+#define GPIOA           (&hostGpioA)
+#define GPIOB           (&hostGpioB)
+#define GPIOC           (&hostGpioC)
+#define TIM2            (&hostTim2)
+#define TIM3            (&hostTim3)
+#define DMA1            (&hostDma1)
+#define DMA1_Channel2   (&hostDma1Channel2)
+#define DMA1_Channel3   (&hostDma1Channel3)
+#define RCC             (&hostRcc)
+#define AFIO            (&hostAfio)
+
+// Bit-band regions, only used to build the GPIO aliases (which the harness replaces)
+#define PERIPH_BASE     0x40000000UL
+#define PERIPH_BB_BASE  0x42000000UL
+
+#define GPIO_PIN_0      ((uint16_t)0x0001)
+#define GPIO_PIN_1      ((uint16_t)0x0002)
+#define GPIO_PIN_2      ((uint16_t)0x0004)
+#define GPIO_PIN_3      ((uint16_t)0x0008)
+#define GPIO_PIN_4      ((uint16_t)0x0010)
+#define GPIO_PIN_5      ((uint16_t)0x0020)
+#define GPIO_PIN_6      ((uint16_t)0x0040)
+#define GPIO_PIN_7      ((uint16_t)0x0080)
+#define GPIO_PIN_8      ((uint16_t)0x0100)
+#define GPIO_PIN_9      ((uint16_t)0x0200)
+#define GPIO_PIN_10     ((uint16_t)0x0400)
+#define GPIO_PIN_11     ((uint16_t)0x0800)
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+
+#define TIM_CR1_CEN     0x0001U
+#define TIM_CR1_ARPE    0x0080U
+#define TIM_DIER_UDE    0x0100U
+#define TIM_EGR_UG      0x0001U
+#define TIM_FLAG_UPDATE 0x0001U
+#define TIM_DMA_UPDATE  0x0100U
+#define TIM_DMA_CC3     0x0800U
+#define TIM_CHANNEL_3   0x0008U
+
+#define RCC_CFGR_PPRE1  0x0700U
+#define RCC_HCLK_DIV1   0x0000U
+
+/* Handles -------------------------------------------------------------------*/
+typedef struct {
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+    DMA_Channel_TypeDef *Instance;
+    DMA_InitTypeDef Init;
+    void *Parent;
+    void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    uint32_t ChannelIndex;
+} DMA_HandleTypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} UART_HandleTypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+} GPIO_InitTypeDef;
+
+#define DMA_PERIPH_TO_MEMORY    0x00000000U
+#define DMA_MEMORY_TO_PERIPH    0x00000010U
+#define DMA_PINC_DISABLE        0x00000000U
+#define DMA_MINC_ENABLE         0x00000080U
+#define DMA_PDATAALIGN_WORD     0x00000200U
+#define DMA_MDATAALIGN_BYTE     0x00000000U
+#define DMA_CIRCULAR            0x00000020U
+#define DMA_PRIORITY_VERY_HIGH  0x00003000U
+
+typedef enum {
+    DMA1_Channel2_IRQn = 12,
+    DMA1_Channel3_IRQn = 13,
+    EXTI3_IRQn = 9,
+} IRQn_Type;
+
+/* Calls ---------------------------------------------------------------------*/
+uint32_t HAL_GetTick(void);
+
+static inline void __DMB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+static inline uint32_t HAL_RCC_GetPCLK1Freq(void) { return 36000000U; }
+static inline void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+    if (state) { port->ODR |= pin; } else { port->ODR &= ~(uint32_t)pin; }
+}
+static inline void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) { (void)port; (void)init; }
+static inline HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) { (void)hdma; return HAL_OK; }
+// A macro, since the firmware passes it addresses cast to 32 bits
+#define HAL_DMA_Start_IT(hdma, src, dst, len)       ((void)(hdma))
+static inline HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *tim) { (void)tim; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *tim) { (void)tim; return HAL_OK; }
+static inline void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub) { (void)irq; (void)pre; (void)sub; }
+static inline void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+
+#define __HAL_RCC_TIM3_CLK_ENABLE()                 do { } while (0)
+#define __HAL_TIM_SET_AUTORELOAD(h, v)              ((h)->Instance->ARR = (v))
+#define __HAL_TIM_SET_PRESCALER(h, v)               ((h)->Instance->PSC = (v))
+#define __HAL_TIM_SET_COMPARE(h, ch, v)             ((h)->Instance->CCR3 = (v))
+#define __HAL_TIM_ENABLE_DMA(h, d)                  ((h)->Instance->DIER |= (d))
+#define __HAL_TIM_GET_FLAG(h, f)                    (((h)->Instance->SR & (f)) == (f))
+#define __HAL_TIM_CLEAR_FLAG(h, f)                  ((h)->Instance->SR = ~(uint32_t)(f))
+#define __HAL_DMA_GET_TC_FLAG_INDEX(h)              0x2U
+#define __HAL_DMA_GET_HT_FLAG_INDEX(h)              0x4U
+#define __HAL_DMA_GET_FLAG(h, f)                    (DMA1->ISR & (f))
+
+#endif
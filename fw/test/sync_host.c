@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file           : sync_host.c
+  * @brief          : The firmware's sync.c built for the host, with its
+  *                   neighbours stubbed out
+  *
+  * sync.c is included whole, so the tests run the same TX ring, deframer and
+  * DPLL code as the firmware, and this file can get at its static helpers.
+  * The GPIO bit-band aliases are swapped for plain register reads & writes
+  * on the stand-in peripherals from stub/stm32f1xx_hal.h. Frames the main
+  * loop would hand to hdlc.c go to hostRxFrame instead.
+  ******************************************************************************
+  */
+
+// Pulled in first so the bit-band aliases can be replaced before sync.c uses them
+#include "util.h"
+
+#include <stdlib.h>
+
+#undef GPIO_BB_IN
+#undef GPIO_BB_OUT
+#define GPIO_BB_IN(port, pin)   (((port)->IDR & (pin)) != 0)
+// Pin writes land in hostPinOut, by pin number (the port isn't kept)
+#define GPIO_BB_OUT(port, pin)  hostPinOut[__builtin_ctz(pin)]
+uint32_t hostPinOut[16];
+
+#include "../v24/src/sync.c"
+
+#include "sync_host.h"
+
+// Stand-in peripherals
+GPIO_TypeDef hostGpioA, hostGpioB, hostGpioC;
+TIM_TypeDef hostTim2, hostTim3;
+DMA_Channel_TypeDef hostDma1Channel2, hostDma1Channel3;
+DMA_TypeDef hostDma1;
+RCC_TypeDef hostRcc;
+AFIO_TypeDef hostAfio;
+
+uint32_t hostTick = 0;
+HostRxFrameFn_t hostRxFrame = NULL;
+unsigned long hostSyncResets = 0;
+
+// Frame counters kept by hdlc.c
+unsigned long rxValidFrames = 0;
+unsigned long rxTotalFrames = 0;
+unsigned long txTotalFrames = 0;
+
+uint32_t HAL_GetTick(void)
+{
+    return hostTick;
+}
+
+void Error_Handler(void)
+{
+    abort();
+}
+
+void log_log(int level, const char *file, int line, const char *fmt, ...)
+{
+    (void)level; (void)file; (void)line; (void)fmt;
+}
+
+bool VCPWriteDebug1(const char *text)
+{
+    (void)text;
+    return true;
+}
+
+bool VCPWriteDebug2(const char *text, int16_t n1)
+{
+    (void)text; (void)n1;
+    return true;
+}
+
+void TxqReset()
+{
+}
+
+/**
+ * @brief Called by every SyncReset()
+*/
+void HdlcReset()
+{
+    hostSyncResets++;
+}
+
+uint8_t HDLCParseMsg(uint8_t *msg, uint16_t len, bool fcsOk, uint32_t rxTick)
+{
+    (void)rxTick;
+    if (hostRxFrame != NULL)
+    {
+        hostRxFrame(msg, len, fcsOk);
+    }
+    return 0;
+}
+
+/**
+ * @brief Put the sync engine back to how it starts up, with RX past its startup delay
+*/
+void HostSyncInit()
+{
+    BitStuffInit();
+    CrcInit();
+    SyncReset();
+    // Drain the mailbox, then run the clock past the RX delay
+    SyncEventCallback();
+    hostTick += SYNC_RX_DELAY;
+    syncTxHead = 0;
+    syncTxTail = 0;
+    syncTxIdlePos = 0;
+    #ifdef HDLC_CTRL_FAST_LANE
+    syncTxCtrlHead = 0;
+    syncTxCtrlTail = 0;
+    syncTxMarkHead = 0;
+    syncTxMarkTail = 0;
+    syncTxBoundary = true;
+    #endif
+    #ifdef SYNC_RX_OVERSAMPLE
+    dpllPhase = 0;
+    dpllFreq = 0;
+    dpllSampled = false;
+    dpllLast = 0;
+    #endif
+    hostSyncResets = 0;
+}
+
+/**
+ * @brief Run the sync engine's main loop callbacks
+*/
+void HostSyncPoll()
+{
+    SyncEventCallback();
+    RxMessageCallback();
+}
+
+/**
+ * @brief Throw away everything queued in the TX ring, as if it had been sent
+*/
+void HostSyncTxDrain()
+{
+    syncTxTail = syncTxHead;
+    #ifdef HDLC_CTRL_FAST_LANE
+    syncTxMarkTail = syncTxMarkHead;
+    #endif
+}
+
+/**
+ * @brief Get the number of line bits waiting in the TX ring
+*/
+uint16_t HostSyncTxUsed()
+{
+    return (syncTxHead - syncTxTail) & (SYNC_TX_RING_BITS - 1);
+}
+
+/**
+ * @brief Sample RXD once, the way the timer interrupt does on each rising TX clock edge
+*/
+void HostSyncRxPin(bool level)
+{
+    if (level)
+    {
+        hostGpioB.IDR |= DCE_RXD_Pin;
+    }
+    else
+    {
+        hostGpioB.IDR &= ~(uint32_t)DCE_RXD_Pin;
+    }
+    RxBits();
+}
+
+#ifdef SYNC_RX_OVERSAMPLE
+/**
+ * @brief Run a block of oversampled GPIO input words through the DPLL, like the TIM3 DMA callbacks do
+*/
+void HostSyncRxOversampled(const uint8_t *samples, uint16_t len)
+{
+    rxDpllBlock(samples, len);
+}
+#endif
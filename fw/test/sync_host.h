@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file           : sync_host.h
+  * @brief          : Header for sync_host.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SYNC_HOST_H
+#define __SYNC_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sync.h"
+
+// What HAL_GetTick() returns
+extern uint32_t hostTick;
+
+// Called with each frame the main loop hands to the HDLC layer
+typedef void (*HostRxFrameFn_t)(const uint8_t *data, uint16_t len, bool fcsOk);
+extern HostRxFrameFn_t hostRxFrame;
+
+// Number of sync resets (a 7 ones abort, or anything else that drops sync)
+extern unsigned long hostSyncResets;
+
+// sync.c internals the tests look at
+extern uint32_t syncTxRing[SYNC_TX_RING_WORDS];
+extern volatile uint16_t syncTxHead;
+extern volatile uint16_t syncTxTail;
+extern volatile uint8_t syncTxIdlePos;
+#ifdef HDLC_CTRL_FAST_LANE
+extern uint32_t syncTxCtrlRing[SYNC_TX_CTRL_WORDS];
+extern volatile uint16_t syncTxCtrlHead;
+extern volatile uint16_t syncTxCtrlTail;
+extern bool syncTxBoundary;
+#endif
+bool NextTxBit();
+
+void HostSyncInit();
+void HostSyncPoll();
+void HostSyncTxDrain();
+uint16_t HostSyncTxUsed();
+void HostSyncRxPin(bool level);
+#ifdef SYNC_RX_OVERSAMPLE
+void HostSyncRxOversampled(const uint8_t *samples, uint16_t len);
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file           : test.h
+  * @brief          : Shared helpers for the host tests & benchmarks
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Number of failed checks, a test exits non-zero if there are any
+extern unsigned long testFailures;
+
+// Report a failed check (with where it was) and carry on, up to a limit so a broken build doesn't flood the output
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            if (testFailures++ < 20) \
+            { \
+                printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                printf(__VA_ARGS__); \
+                printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+// Define once per test, next to main()
+#define TEST_GLOBALS unsigned long testFailures = 0;
+
+/**
+ * @brief Finish a test, printing the result
+ * @param name test name
+ * @return exit code for main()
+*/
+static inline int testResult(const char *name)
+{
+    if (testFailures)
+    {
+        printf("%s: %lu checks FAILED\n", name, testFailures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+/**
+ * @brief Small xorshift PRNG, so runs are repeatable from their seed
+*/
+static inline uint32_t testRand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Random number from lo to hi inclusive
+*/
+static inline uint32_t testRandRange(uint32_t *state, uint32_t lo, uint32_t hi)
+{
+    return lo + testRand(state) % (hi - lo + 1U);
+}
+
+/**
+ * @brief Monotonic time in seconds, for the benchmarks
+*/
+static inline double testNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Get a count from the command line (so longer runs can be asked for), or the default
+*/
+static inline unsigned long testArgCount(int argc, char **argv, unsigned long def)
+{
+    if (argc > 1)
+    {
+        return strtoul(argv[1], NULL, 0);
+    }
+    return def;
+}
+
+#endif
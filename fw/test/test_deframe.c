@@ -0,0 +1,263 @@
+/**
+  ******************************************************************************
+  * @file           : test_deframe.c
+  * @brief          : Differential test of the table driven RX deframer
+  *                   against the old bit at a time one
+  *
+  * A random line bitstream is fed to both deframers: the old RxBits() a bit
+  * at a time (ref/sync_rx_old.c), and SyncRxDeframe() 8 bits at a time the
+  * way the capture paths hand it over. The stream is frames of random length,
+  * heavy in 0x7E, 0x7D & 0xFF, between one or more flags. Most carry a good
+  * FCS, some have a payload bit flipped so the FCS is bad, and some are cut
+  * off with an abort. Every frame has to come out of both deframers with the
+  * same bytes, and the new one has to get the FCS check right.
+  *
+  * Bit errors are made in the frame rather than on the line, since a line
+  * error can move where each deframer next finds a flag (the old one only
+  * looks for one on a byte boundary). Aborts are followed by 16 more ones,
+  * so both have flushed anything left over before they look for the next
+  * flag. Frames never start with a data 0x7E, which the old one dropped.
+  *
+  * Usage: test_deframe [number of frames]
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "crc.h"
+#include "sync_host.h"
+#include "sync_rx_old.h"
+#include "test.h"
+
+TEST_GLOBALS
+
+// Frames waiting to come out of each deframer
+#define EXPECT_FRAMES   8U
+
+typedef struct {
+    uint16_t len;
+    bool fcsOk;
+    uint8_t data[SYNC_RX_FRAME_MAX];
+} Expect_t;
+
+Expect_t expect[EXPECT_FRAMES];
+unsigned long expectHead = 0;
+unsigned long oldTail = 0;
+unsigned long newTail = 0;
+
+// Line bits waiting to go to the new deframer, and the ones count for stuffing
+uint8_t lineBits = 0;
+uint8_t lineCount = 0;
+uint8_t lineOnes = 0;
+
+unsigned long fcsGood = 0;
+unsigned long fcsBad = 0;
+
+/**
+ * @brief Bitwise CRC-16/X.25, independent of the table kernels in crc.c
+*/
+static uint16_t crcBitwise(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            crc = (crc & 0x1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Check a frame out of the old deframer against the one sent
+*/
+static void oldFrame(const uint8_t *data, uint16_t len)
+{
+    if (oldTail == expectHead)
+    {
+        CHECK(false, "old deframer gave an unexpected %u byte frame", len);
+        return;
+    }
+    const Expect_t *e = &expect[oldTail++ % EXPECT_FRAMES];
+    CHECK(len == e->len && memcmp(data, e->data, len) == 0,
+        "old deframer gave %u bytes for a %u byte frame", len, e->len);
+}
+
+/**
+ * @brief Check a frame out of the new deframer against the one sent, which the old one has to have given too
+*/
+static void newFrame(const uint8_t *data, uint16_t len, bool fcsOk)
+{
+    if (newTail == expectHead)
+    {
+        CHECK(false, "new deframer gave an unexpected %u byte frame", len);
+        return;
+    }
+    CHECK(newTail < oldTail, "new deframer gave a frame the old one didn't");
+    const Expect_t *e = &expect[newTail++ % EXPECT_FRAMES];
+    CHECK(len == e->len && memcmp(data, e->data, len) == 0,
+        "new deframer gave %u bytes for a %u byte frame", len, e->len);
+    CHECK(fcsOk == e->fcsOk, "new deframer got the FCS of a %u byte frame wrong", e->len);
+}
+
+/**
+ * @brief Send a bit to both deframers, the new one gets them 8 at a time
+*/
+static void lineBit(uint8_t bit)
+{
+    OldRxBit(bit);
+    lineBits |= bit << lineCount;
+    if (++lineCount == 8)
+    {
+        OldRxMessageCallback();
+        SyncRxDeframe(lineBits);
+        HostSyncPoll();
+        lineBits = 0;
+        lineCount = 0;
+    }
+}
+
+static void lineFlag()
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        lineBit((HDLC_SYNC_WORD >> i) & 0x1);
+    }
+    lineOnes = 0;
+}
+
+/**
+ * @brief Send a frame byte, with a 0 stuffed after every 5 ones
+*/
+static void lineByte(uint8_t byte)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        uint8_t bit = (byte >> i) & 0x1;
+        lineBit(bit);
+        if (!bit)
+        {
+            lineOnes = 0;
+        }
+        else if (++lineOnes == 5)
+        {
+            lineBit(0);
+            lineOnes = 0;
+        }
+    }
+}
+
+/**
+ * @brief Random frame byte, weighted towards the ones that get stuffed or look like flags
+*/
+static uint8_t randFrameByte(uint32_t *rng)
+{
+    switch (testRand(rng) % 8U)
+    {
+        case 0: return 0x7E;
+        case 1: return 0x7D;
+        case 2:
+        case 3: return 0xFF;
+        default: return testRand(rng);
+    }
+}
+
+/**
+ * @brief Make up the next frame and send it, with the flags before it
+*/
+static void sendFrame(uint32_t *rng, unsigned long *aborts)
+{
+    Expect_t *e = &expect[expectHead % EXPECT_FRAMES];
+
+    // Mostly short frames, like the link control & status traffic, with some up to full size
+    e->len = (testRand(rng) % 4U) ? testRandRange(rng, 1U, 40U) : testRandRange(rng, 1U, SYNC_RX_FRAME_MAX);
+    for (uint16_t i = 0; i < e->len; i++)
+    {
+        e->data[i] = randFrameByte(rng);
+    }
+    if (e->data[0] == HDLC_SYNC_WORD)
+    {
+        e->data[0] = 0x7F;
+    }
+    if (e->len >= 4U)
+    {
+        uint16_t fcs = crcBitwise(0xFFFF, e->data, e->len - 2U) ^ 0xFFFF;
+        e->data[e->len - 2U] = fcs & 0xFF;
+        e->data[e->len - 1U] = fcs >> 8;
+        // A bit error in a few
+        if (testRand(rng) % 16U == 0)
+        {
+            e->data[testRandRange(rng, 1U, e->len - 1U)] ^= 1U << (testRand(rng) % 8U);
+        }
+    }
+    e->fcsOk = e->len >= 4U && crcBitwise(0xFFFF, e->data, e->len) == CRC16_X25_RESIDUE;
+
+    uint8_t flags = testRandRange(rng, 1U, 3U);
+    for (uint8_t i = 0; i < flags; i++)
+    {
+        lineFlag();
+    }
+
+    // Cut a few off part way with an abort
+    if (e->len > 2U && testRand(rng) % 32U == 0)
+    {
+        uint16_t cut = testRandRange(rng, 2U, e->len - 1U);
+        for (uint16_t i = 0; i < cut; i++)
+        {
+            lineByte(e->data[i]);
+        }
+        uint8_t ones = 7U + 16U + testRand(rng) % 8U;
+        for (uint8_t i = 0; i < ones; i++)
+        {
+            lineBit(1);
+        }
+        lineOnes = 0;
+        (*aborts)++;
+        return;
+    }
+
+    // Only frames of 2 bytes or more come out
+    if (e->len >= 2U)
+    {
+        expectHead++;
+        if (e->fcsOk) { fcsGood++; } else { fcsBad++; }
+    }
+    for (uint16_t i = 0; i < e->len; i++)
+    {
+        lineByte(e->data[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = testArgCount(argc, argv, 2000000UL);
+    uint32_t rng = 0xDEC0DEU;
+    unsigned long aborts = 0;
+
+    HostSyncInit();
+    OldSyncReset();
+    hostRxFrame = newFrame;
+    oldRxFrame = oldFrame;
+
+    double start = testNow();
+    unsigned long sent = 0;
+    while (sent < frames && testFailures == 0)
+    {
+        sendFrame(&rng, &aborts);
+        sent++;
+    }
+    // Close the last frame and flush it through
+    lineFlag();
+    lineFlag();
+    double secs = testNow() - start;
+
+    CHECK(oldTail == expectHead, "old deframer gave %lu of %lu frames", oldTail, expectHead);
+    CHECK(newTail == expectHead, "new deframer gave %lu of %lu frames", newTail, expectHead);
+    CHECK(oldRxAborts == aborts, "old deframer saw %lu of %lu aborts", oldRxAborts, aborts);
+    CHECK(hostSyncResets == aborts, "new deframer saw %lu of %lu aborts", hostSyncResets, aborts);
+    printf("%lu random frames in %.1f s: %lu good FCS, %lu bad FCS, %lu runts, %lu aborted\n", sent, secs,
+        fcsGood, fcsBad, sent - expectHead - aborts, aborts);
+
+    return testResult("deframe");
+}
@@ -0,0 +1,248 @@
+/**
+  ******************************************************************************
+  * @file           : test_dpll.c
+  * @brief          : Oversampled RX DPLL test against the old once per bit
+  *                   sampler, with clock skew & edge jitter on the line
+  *
+  * For each setting a line is made up of random frames sent by the firmware's
+  * own TX path (SyncAddTxFrame() and NextTxBit()), with idle flags before
+  * and between them. That's turned into an RXD waveform from a transmitter
+  * whose bit clock is off from ours by the skew, with every edge moved by a
+  * random amount up to the jitter. The waveform is sampled
+  * SYNC_RX_OVERSAMPLE times per bit and run through the DPLL, and separately
+  * sampled once per bit and run through RxBits() the way the line timer did
+  * before.
+  *
+  * The DPLL has to get every frame through at up to 2% skew and +/-0.2 bits
+  * of jitter. The old sampler's results are reported for comparison, and it
+  * has to lose frames at 2% skew, which shows the skew is really there.
+  *
+  * Usage: test_dpll [frames per setting]
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "sync_host.h"
+#include "test.h"
+
+TEST_GLOBALS
+
+// Idle flags before the first frame (the line idles with flags, so the DPLL has locked by the time a frame comes)
+#define DPLL_LEAD_BITS      1024U
+// Idle flags between frames, and after the last
+#define DPLL_GAP_BITS       16U
+#define DPLL_FRAME_MAX      255U
+#define DPLL_BLOCK          (SYNC_RX_OS_SAMPLES / 2)
+// Worst case line bits per frame, with stuffing and its flags
+#define DPLL_FRAME_BITS     ((DPLL_FRAME_MAX + 2U) * 10U + DPLL_GAP_BITS + 16U)
+
+typedef struct {
+    double skew;        // transmitter bit period error, 0.02 is a 2% slow transmitter
+    double jitter;      // most any edge is moved by, in bits
+} Setting_t;
+
+static const Setting_t settings[] = {
+    { 0.0, 0.0 },
+    { 0.01, 0.0 },
+    { -0.01, 0.0 },
+    { 0.02, 0.0 },
+    { -0.02, 0.0 },
+    { 0.0, 0.2 },
+    { 0.02, 0.2 },
+    { -0.02, 0.2 },
+};
+
+// Frames sent, and the next one we expect back
+uint8_t (*txFrames)[DPLL_FRAME_MAX];
+uint16_t *txFrameLens;
+unsigned long txFrameCount = 0;
+unsigned long rxNext = 0;
+unsigned long rxGood = 0;
+
+// Line bits, and the transmitter's timing
+uint8_t *lineBits;
+uint32_t lineLen = 0;
+double lineStart = 0.0;
+double linePeriod = 1.0;
+double lineJitter = 0.0;
+uint32_t lineSeed = 0;
+
+/**
+ * @brief Count each frame that comes back intact, frames lost along the way are skipped over
+*/
+static void checkRxFrame(const uint8_t *data, uint16_t len, bool fcsOk)
+{
+    if (!fcsOk)
+    {
+        return;
+    }
+    for (unsigned long n = rxNext; n < txFrameCount && n < rxNext + 8U; n++)
+    {
+        if (len == txFrameLens[n] + 2U && memcmp(data, txFrames[n], txFrameLens[n]) == 0)
+        {
+            rxGood++;
+            rxNext = n + 1;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Send idle flags
+*/
+static void lineIdle(uint32_t bits)
+{
+    for (uint32_t i = 0; i < bits; i++)
+    {
+        lineBits[lineLen++] = NextTxBit();
+    }
+}
+
+/**
+ * @brief Make up the frames, and get the line bits the TX path sends for them
+*/
+static void makeLine(uint32_t *rng, const Setting_t *s, unsigned long frames)
+{
+    HostSyncInit();
+    lineLen = 0;
+    lineIdle(DPLL_LEAD_BITS);
+    for (txFrameCount = 0; txFrameCount < frames; txFrameCount++)
+    {
+        uint8_t *frame = txFrames[txFrameCount];
+        uint16_t len = testRandRange(rng, 2U, DPLL_FRAME_MAX);
+        for (uint16_t i = 0; i < len; i++)
+        {
+            // Plenty of long runs of ones, so stuffing leaves the fewest transitions
+            frame[i] = (testRand(rng) % 2U) ? 0xFF : testRand(rng);
+        }
+        txFrameLens[txFrameCount] = len;
+        SyncAddTxFrame(frame, len);
+        while (HostSyncTxUsed() > 0)
+        {
+            lineBits[lineLen++] = NextTxBit();
+        }
+        lineIdle(DPLL_GAP_BITS);
+    }
+
+    // Transmitter starts somewhere in our first bit
+    lineStart = testRand(rng) / 4294967296.0;
+    linePeriod = 1.0 + s->skew;
+    lineJitter = s->jitter;
+    lineSeed = testRand(rng);
+}
+
+/**
+ * @brief Get the time of the edge at the start of a line bit, jittered the same way every time it's asked for
+*/
+static double lineEdge(uint32_t bit)
+{
+    uint32_t x = (bit + 1U) * 2654435761U ^ lineSeed;
+    testRand(&x);
+    testRand(&x);
+    double jitter = (testRand(&x) / 4294967295.0) * 2.0 - 1.0;
+    return lineStart + bit * linePeriod + jitter * lineJitter;
+}
+
+/**
+ * @brief Get RXD at a time (in our bit periods), times have to go forwards from the last call
+ * @param *pos line bit the last call was in, 0 to start
+*/
+static uint8_t lineLevel(double t, uint32_t *pos)
+{
+    while (*pos < lineLen && t >= lineEdge(*pos + 1))
+    {
+        (*pos)++;
+    }
+    // Idle flags end in a 0, so the line sits there before & after
+    if (*pos >= lineLen || t < lineEdge(0))
+    {
+        return 0;
+    }
+    return lineBits[*pos];
+}
+
+/**
+ * @brief Sample the line SYNC_RX_OVERSAMPLE times a bit and run it through the DPLL
+ * @return number of frames that came back
+*/
+static unsigned long runDpll()
+{
+    uint8_t samples[DPLL_BLOCK];
+    uint32_t pos = 0;
+    uint64_t n = 0;
+    uint64_t end = (uint64_t)((lineEdge(lineLen) + 1.0) * SYNC_RX_OVERSAMPLE);
+    HostSyncInit();
+    rxNext = 0;
+    rxGood = 0;
+    while (n < end)
+    {
+        for (uint16_t i = 0; i < DPLL_BLOCK; i++, n++)
+        {
+            samples[i] = lineLevel((double)n / SYNC_RX_OVERSAMPLE, &pos) ? DCE_RXD_Pin : 0;
+        }
+        HostSyncRxOversampled(samples, DPLL_BLOCK);
+        HostSyncPoll();
+    }
+    return rxGood;
+}
+
+/**
+ * @brief Sample the line once a bit, half way through our own bit period, like the line timer did
+ * @return number of frames that came back
+*/
+static unsigned long runOld()
+{
+    uint32_t pos = 0;
+    uint32_t end = (uint32_t)(lineEdge(lineLen) + 1.0);
+    HostSyncInit();
+    rxNext = 0;
+    rxGood = 0;
+    for (uint32_t n = 0; n < end; n++)
+    {
+        HostSyncRxPin(lineLevel(n + 0.5, &pos));
+        if ((n & 0x7) == 0x7)
+        {
+            HostSyncPoll();
+        }
+    }
+    HostSyncPoll();
+    return rxGood;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = testArgCount(argc, argv, 400UL);
+    txFrames = malloc(frames * sizeof(*txFrames));
+    txFrameLens = malloc(frames * sizeof(*txFrameLens));
+    lineBits = malloc(DPLL_LEAD_BITS + frames * DPLL_FRAME_BITS);
+    if (txFrames == NULL || txFrameLens == NULL || lineBits == NULL)
+    {
+        printf("out of memory\n");
+        return 1;
+    }
+    hostRxFrame = checkRxFrame;
+
+    printf("%lu frames per setting, %u samples per bit:\n", frames, SYNC_RX_OVERSAMPLE);
+    for (uint8_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        const Setting_t *s = &settings[i];
+        uint32_t rng = 0x5EED0000U + i;
+        makeLine(&rng, s, frames);
+        unsigned long dpllGood = runDpll();
+        unsigned long oldGood = runOld();
+        printf("  skew %+4.1f%%, jitter +/-%.1f bit: DPLL %4lu/%lu, old sampler %4lu/%lu\n", s->skew * 100.0,
+            s->jitter, dpllGood, frames, oldGood, frames);
+        CHECK(dpllGood == frames, "DPLL lost %lu frames at %+.1f%% skew, +/-%.1f bit jitter", frames - dpllGood,
+            s->skew * 100.0, s->jitter);
+        if (s->skew >= 0.02 || s->skew <= -0.02)
+        {
+            CHECK(oldGood < frames, "old sampler got every frame through at %+.1f%% skew", s->skew * 100.0);
+        }
+    }
+
+    free(txFrames);
+    free(txFrameLens);
+    free(lineBits);
+    return testResult("dpll");
+}
@@ -0,0 +1,291 @@
+/**
+  ******************************************************************************
+  * @file           : test_ring.c
+  * @brief          : Ring_t multithreaded stress test, and throughput against
+  *                   the old FIFO_t
+  *
+  * The stress test runs a producer and a consumer thread over a small ring,
+  * both picking byte, bulk and span calls at random, and checks every byte
+  * comes out in order. The benchmark moves 370-byte messages (a long DVM
+  * message) through a 1 KB buffer a byte at a time with FIFO_t and Ring_t,
+  * and in bulk with Ring_t.
+  *
+  * Usage: test_ring [bytes to move in the stress test]
+  ******************************************************************************
+  */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "fifo.h"
+#include "ring.h"
+#include "test.h"
+
+TEST_GLOBALS
+
+// Stress test ring, small so both sides keep running into full & empty
+#define STRESS_RING_LEN     256U
+#define STRESS_MAX_CHUNK    64U
+
+// Benchmark message & buffer sizes
+#define BENCH_MSG_LEN       370U
+#define BENCH_BUF_LEN       1024U
+#define BENCH_BYTES         (256UL * 1024UL * 1024UL)
+
+uint8_t stressBuf[STRESS_RING_LEN];
+Ring_t stressRing = RING_INIT(stressBuf);
+unsigned long stressBytes = 0;
+
+/**
+ * @brief The byte at a position in the stress stream, which doesn't repeat every ring length
+*/
+static inline uint8_t stressByte(unsigned long pos)
+{
+    uint32_t x = (uint32_t)pos * 2654435761U;
+    return (uint8_t)(x >> 24) ^ (uint8_t)(pos >> 8);
+}
+
+/**
+ * @brief Producer thread, writes the stream with a random mix of push, bulk write & span calls
+*/
+static void *stressProducer(void *arg)
+{
+    (void)arg;
+    uint32_t rng = 0x1234567U;
+    uint8_t chunk[STRESS_MAX_CHUNK];
+    unsigned long pos = 0;
+    while (pos < stressBytes)
+    {
+        // Let the other side run if the ring's full, the host may only have the one core
+        if (RingFree(&stressRing) == 0)
+        {
+            sched_yield();
+        }
+        unsigned long left = stressBytes - pos;
+        uint16_t len = testRandRange(&rng, 1U, STRESS_MAX_CHUNK);
+        if (len > left)
+        {
+            len = left;
+        }
+        switch (testRand(&rng) % 3U)
+        {
+            case 0:
+                if (RingPush(&stressRing, stressByte(pos)))
+                {
+                    pos++;
+                }
+                break;
+            case 1:
+                for (uint16_t i = 0; i < len; i++)
+                {
+                    chunk[i] = stressByte(pos + i);
+                }
+                // All or nothing, so it either moves on by len or not at all
+                if (RingWrite(&stressRing, chunk, len))
+                {
+                    pos += len;
+                }
+                break;
+            default:
+            {
+                uint8_t *span;
+                uint16_t room = RingWriteSpan(&stressRing, &span);
+                if (room > len)
+                {
+                    room = len;
+                }
+                for (uint16_t i = 0; i < room; i++)
+                {
+                    span[i] = stressByte(pos + i);
+                }
+                RingWriteCommit(&stressRing, room);
+                pos += room;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Consumer thread, reads the stream back with a random mix of pop, peek, bulk read & span calls
+*/
+static void *stressConsumer(void *arg)
+{
+    (void)arg;
+    uint32_t rng = 0x7654321U;
+    uint8_t chunk[STRESS_MAX_CHUNK];
+    unsigned long pos = 0;
+    unsigned long errors = 0;
+    while (pos < stressBytes && errors < 10)
+    {
+        uint16_t used = RingUsed(&stressRing);
+        if (used == 0)
+        {
+            sched_yield();
+        }
+        if (used > STRESS_RING_LEN)
+        {
+            CHECK(false, "ring holds %u bytes, more than its size", used);
+            errors++;
+        }
+        uint16_t len = testRandRange(&rng, 1U, STRESS_MAX_CHUNK);
+        uint16_t got = 0;
+        switch (testRand(&rng) % 4U)
+        {
+            case 0:
+                if (RingPop(&stressRing, chunk))
+                {
+                    got = 1;
+                }
+                break;
+            case 1:
+                got = RingRead(&stressRing, chunk, len);
+                break;
+            case 2:
+            {
+                uint8_t *span;
+                got = RingReadSpan(&stressRing, &span);
+                if (got > len)
+                {
+                    got = len;
+                }
+                memcpy(chunk, span, got);
+                RingReadCommit(&stressRing, got);
+            }
+            break;
+            default:
+            {
+                // Peek somewhere in what's there without reading it
+                uint8_t b;
+                if (used > 0 && RingPeek(&stressRing, len % used, &b))
+                {
+                    if (b != stressByte(pos + len % used))
+                    {
+                        CHECK(false, "peek at %lu+%u got %02X, expected %02X", pos, len % used, b,
+                            stressByte(pos + len % used));
+                        errors++;
+                    }
+                }
+            }
+            break;
+        }
+        for (uint16_t i = 0; i < got; i++)
+        {
+            if (chunk[i] != stressByte(pos + i))
+            {
+                CHECK(false, "byte %lu is %02X, expected %02X", pos + i, chunk[i], stressByte(pos + i));
+                errors++;
+                break;
+            }
+        }
+        pos += got;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run the producer & consumer threads over the stress ring
+*/
+static void stressTest(unsigned long bytes)
+{
+    stressBytes = bytes;
+    pthread_t producer, consumer;
+    double start = testNow();
+    pthread_create(&consumer, NULL, stressConsumer, NULL);
+    pthread_create(&producer, NULL, stressProducer, NULL);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    double secs = testNow() - start;
+    CHECK(RingUsed(&stressRing) == 0, "%u bytes left in the ring", RingUsed(&stressRing));
+    printf("stress: %lu bytes through a %u byte ring in %.2f s, high water %u\n", bytes, STRESS_RING_LEN, secs,
+        stressRing.highWater);
+}
+
+/**
+ * @brief Time moving messages through FIFO_t a byte at a time, the way the firmware used it
+*/
+static double benchFifo(const uint8_t *msg, uint32_t *sum)
+{
+    static uint8_t buf[BENCH_BUF_LEN];
+    FIFO_t fifo = { .buffer = buf, .size = 0, .head = 0, .tail = 0, .maxlen = BENCH_BUF_LEN };
+    double start = testNow();
+    for (unsigned long done = 0; done < BENCH_BYTES; done += BENCH_MSG_LEN)
+    {
+        for (uint16_t i = 0; i < BENCH_MSG_LEN; i++)
+        {
+            FifoPush(&fifo, msg[i]);
+        }
+        uint8_t b;
+        while (FifoPop(&fifo, &b) == 0)
+        {
+            *sum += b;
+        }
+    }
+    return testNow() - start;
+}
+
+/**
+ * @brief Time moving messages through Ring_t a byte at a time
+*/
+static double benchRingByte(const uint8_t *msg, uint32_t *sum)
+{
+    static uint8_t buf[BENCH_BUF_LEN];
+    Ring_t ring = RING_INIT(buf);
+    double start = testNow();
+    for (unsigned long done = 0; done < BENCH_BYTES; done += BENCH_MSG_LEN)
+    {
+        for (uint16_t i = 0; i < BENCH_MSG_LEN; i++)
+        {
+            RingPush(&ring, msg[i]);
+        }
+        uint8_t b;
+        while (RingPop(&ring, &b))
+        {
+            *sum += b;
+        }
+    }
+    return testNow() - start;
+}
+
+/**
+ * @brief Time moving whole messages through Ring_t with the bulk calls
+*/
+static double benchRingBulk(const uint8_t *msg, uint32_t *sum)
+{
+    static uint8_t buf[BENCH_BUF_LEN];
+    Ring_t ring = RING_INIT(buf);
+    uint8_t out[BENCH_MSG_LEN];
+    double start = testNow();
+    for (unsigned long done = 0; done < BENCH_BYTES; done += BENCH_MSG_LEN)
+    {
+        RingWrite(&ring, msg, BENCH_MSG_LEN);
+        RingRead(&ring, out, BENCH_MSG_LEN);
+        *sum += out[done & 0xFF];
+    }
+    return testNow() - start;
+}
+
+int main(int argc, char **argv)
+{
+    stressTest(testArgCount(argc, argv, 200000000UL));
+
+    uint8_t msg[BENCH_MSG_LEN];
+    uint32_t rng = 1U;
+    for (uint16_t i = 0; i < BENCH_MSG_LEN; i++)
+    {
+        msg[i] = testRand(&rng);
+    }
+    // Summing what comes out keeps the reads from being optimised away
+    uint32_t sum = 0;
+    double mb = BENCH_BYTES / 1e6;
+    printf("throughput, %u byte messages through a %u byte buffer:\n", BENCH_MSG_LEN, BENCH_BUF_LEN);
+    printf("  FIFO_t byte at a time: %8.0f MB/s\n", mb / benchFifo(msg, &sum));
+    printf("  Ring_t byte at a time: %8.0f MB/s\n", mb / benchRingByte(msg, &sum));
+    printf("  Ring_t bulk:           %8.0f MB/s\n", mb / benchRingBulk(msg, &sum));
+    printf("  (checksum %08X)\n", sum);
+
+    return testResult("ring");
+}
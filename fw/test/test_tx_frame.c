@@ -0,0 +1,339 @@
+/**
+  ******************************************************************************
+  * @file           : test_tx_frame.c
+  * @brief          : TX frame path test, FCS fused into the bit stuffing
+  *                   against the old Crc16() then stuffing path
+  *
+  * Random frames, heavy in 0x7E, 0x7D & 0xFF so there's plenty of stuffing,
+  * go through SyncAddTxFrame() and the old path (ref/sync_tx_old.c). The
+  * line bits they queue have to be identical. The new bits are then sent
+  * with NextTxBit() and deframed by the RX side, and each frame has to come
+  * back intact with a good FCS. The ring is then kept full to within a flag
+  * of its tail as it wraps round, and every bit sent has to be the one that
+  * was queued. The same goes for the link control ring, with replies queued
+  * back to back until it's full. Finally both paths are timed in frames per
+  * second, with the ring drained after every frame.
+  *
+  * Usage: test_tx_frame [number of frames]
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "sync_host.h"
+#include "sync_tx_old.h"
+#include "test.h"
+
+TEST_GLOBALS
+
+// Frame sizes the benchmark is run at
+static const uint16_t benchLens[] = { 2U, 100U, 255U, HDLC_MAX_FRAME_SIZE_BYTES };
+
+// The frame sent, and what came back out of the deframer
+uint8_t txFrame[HDLC_MAX_FRAME_SIZE_BYTES + 2U];
+uint16_t txFrameLen = 0;
+unsigned long rxFrames = 0;
+
+// What each TX ring position held when it was queued
+uint8_t txShadow[SYNC_TX_RING_BITS];
+#ifdef HDLC_CTRL_FAST_LANE
+uint8_t txCtrlShadow[SYNC_TX_CTRL_BITS];
+#endif
+
+/**
+ * @brief Check each frame out of the deframer against the one sent
+*/
+static void checkRxFrame(const uint8_t *data, uint16_t len, bool fcsOk)
+{
+    rxFrames++;
+    CHECK(len == txFrameLen + 2U, "frame of %u bytes came back as %u bytes (with FCS)", txFrameLen, len);
+    CHECK(fcsOk, "frame of %u bytes came back with a bad FCS", txFrameLen);
+    CHECK(memcmp(data, txFrame, txFrameLen) == 0, "frame of %u bytes came back changed", txFrameLen);
+}
+
+/**
+ * @brief Random frame byte, weighted towards the ones that get stuffed or look like flags
+*/
+static uint8_t randFrameByte(uint32_t *rng)
+{
+    switch (testRand(rng) % 8U)
+    {
+        case 0: return 0x7E;
+        case 1: return 0x7D;
+        case 2:
+        case 3: return 0xFF;
+        default: return testRand(rng);
+    }
+}
+
+/**
+ * @brief Get a line bit from the ring in the same order the ISR sends it
+*/
+static bool ringBit(const uint32_t *ring, uint16_t pos)
+{
+    return (ring[pos >> 5] >> (pos & 31)) & 0x1;
+}
+
+/**
+ * @brief Send line bits from the TX side into the RX deframer, a byte at a time
+ * @param bits number of bits to send
+*/
+static void loopBits(uint32_t bits)
+{
+    static uint8_t acc = 0;
+    static uint8_t count = 0;
+    for (uint32_t i = 0; i < bits; i++)
+    {
+        acc |= NextTxBit() << count;
+        if (++count == 8)
+        {
+            SyncRxDeframe(acc);
+            acc = 0;
+            count = 0;
+        }
+    }
+}
+
+/**
+ * @brief Queue each frame both ways, compare the line bits, then loop them back through the deframer
+*/
+static void checkFrames(unsigned long frames)
+{
+    uint32_t rng = 0xC0FFEEU;
+    uint8_t oldFrame[HDLC_MAX_FRAME_SIZE_BYTES + 2U];
+    HostSyncInit();
+    hostRxFrame = checkRxFrame;
+    // Idle flags first so the RX side is synced
+    loopBits(32);
+    for (unsigned long n = 0; n < frames && testFailures == 0; n++)
+    {
+        txFrameLen = testRandRange(&rng, 2U, HDLC_MAX_FRAME_SIZE_BYTES);
+        for (uint16_t i = 0; i < txFrameLen; i++)
+        {
+            txFrame[i] = randFrameByte(&rng);
+        }
+        memcpy(oldFrame, txFrame, txFrameLen);
+
+        uint16_t start = syncTxHead;
+        uint16_t oldStart = oldTxHead;
+        CHECK(SyncAddTxFrame(txFrame, txFrameLen), "SyncAddTxFrame refused a %u byte frame", txFrameLen);
+        CHECK(OldSendFrame(oldFrame, txFrameLen), "old path refused a %u byte frame", txFrameLen);
+        uint16_t bits = (syncTxHead - start) & (SYNC_TX_RING_BITS - 1);
+        uint16_t oldBits = (oldTxHead - oldStart) & (OLD_TX_RING_BITS - 1);
+        CHECK(bits == oldBits, "frame of %u bytes is %u line bits, was %u", txFrameLen, bits, oldBits);
+        for (uint16_t i = 0; i < bits && i < oldBits; i++)
+        {
+            if (ringBit(syncTxRing, (start + i) & (SYNC_TX_RING_BITS - 1)) !=
+                ringBit(oldTxRing, (oldStart + i) & (OLD_TX_RING_BITS - 1)))
+            {
+                CHECK(false, "frame of %u bytes differs from the old path at line bit %u", txFrameLen, i);
+                break;
+            }
+        }
+        oldTxTail = oldTxHead;
+
+        // Send it, and some idle flags to push the closing flag through the deframer
+        unsigned long before = rxFrames;
+        loopBits(bits + 16U);
+        CHECK(HostSyncTxUsed() == 0, "%u bits left in the TX ring", HostSyncTxUsed());
+        HostSyncPoll();
+        CHECK(rxFrames == before + 1U, "frame of %u bytes sent, %lu received", txFrameLen, rxFrames - before);
+    }
+    CHECK(hostSyncResets == 0, "RX lost sync %lu times", hostSyncResets);
+    printf("%lu random frames: %lu received\n", frames, rxFrames);
+}
+
+/**
+ * @brief Copy bits just queued in a TX ring into its shadow
+ * @param bits ring size in bits
+*/
+static void shadowBits(const uint32_t *ring, uint8_t *shadow, uint16_t bits, uint16_t start, uint16_t end)
+{
+    for (uint16_t pos = start; pos != end; pos = (pos + 1) & (bits - 1))
+    {
+        shadow[pos] = ringBit(ring, pos);
+    }
+}
+
+/**
+ * @brief Send line bits, checking each one out of the rings is still what was queued there
+*/
+static void sendChecked(uint32_t bits)
+{
+    for (uint32_t i = 0; i < bits; i++)
+    {
+        // Same choice of where the bit comes from as NextTxBit()
+        #ifdef HDLC_CTRL_FAST_LANE
+        bool fromCtrl = syncTxBoundary && syncTxCtrlTail != syncTxCtrlHead;
+        uint16_t ctrlPos = syncTxCtrlTail;
+        #else
+        bool fromCtrl = false;
+        #endif
+        bool fromRing = !fromCtrl && syncTxIdlePos == 0 && syncTxTail != syncTxHead;
+        uint16_t pos = syncTxTail;
+        bool bit = NextTxBit();
+        #ifdef HDLC_CTRL_FAST_LANE
+        if (fromCtrl && bit != txCtrlShadow[ctrlPos])
+        {
+            CHECK(false, "TX control ring bit %u changed after it was queued", ctrlPos);
+            return;
+        }
+        #endif
+        if (fromRing && bit != txShadow[pos])
+        {
+            CHECK(false, "TX ring bit %u changed after it was queued", pos);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Keep the TX ring full to within a flag of its tail while it wraps round, topping it up as bits are sent
+ *
+ * Frames go in until one is refused, then flags fill the rest exactly. Anything queued later that spills over
+ * onto bits still waiting to go shows up as a changed bit when they're sent.
+*/
+static void checkFullRing(unsigned long rounds)
+{
+    uint32_t rng = 0xF0110U;
+    uint8_t frame[HDLC_MAX_FRAME_SIZE_BYTES];
+    unsigned long queued = 0;
+    HostSyncInit();
+    for (unsigned long n = 0; n < rounds && testFailures == 0; n++)
+    {
+        for (;;)
+        {
+            // Mostly short frames, so they still fit once a little has been sent
+            uint16_t len = (testRand(&rng) % 4U) ? testRandRange(&rng, 2U, 16U) :
+                testRandRange(&rng, 2U, HDLC_MAX_FRAME_SIZE_BYTES);
+            for (uint16_t i = 0; i < len; i++)
+            {
+                frame[i] = randFrameByte(&rng);
+            }
+            uint16_t start = syncTxHead;
+            if (!SyncAddTxFrame(frame, len))
+            {
+                break;
+            }
+            shadowBits(syncTxRing, txShadow, SYNC_TX_RING_BITS, start, syncTxHead);
+            queued++;
+        }
+        uint16_t flags = ((syncTxTail - syncTxHead - 1) & (SYNC_TX_RING_BITS - 1)) / 8U;
+        while (flags > 0)
+        {
+            uint8_t count = flags > 255U ? 255U : flags;
+            uint16_t start = syncTxHead;
+            CHECK(SyncAddTxFlags(count), "SyncAddTxFlags refused %u flags that fit", count);
+            shadowBits(syncTxRing, txShadow, SYNC_TX_RING_BITS, start, syncTxHead);
+            flags -= count;
+        }
+        sendChecked(testRandRange(&rng, 1U, 96U));
+    }
+    printf("full ring: %lu frames queued within a flag of the tail\n", queued);
+}
+
+#ifdef HDLC_CTRL_FAST_LANE
+/**
+ * @brief Queue link control frames back to back until the control ring is full, topping it up as bits are sent
+ *
+ * Like the replies to a burst of RR, UA & XID frames, while the main ring has frames of its own going out.
+*/
+static void checkCtrlFrames(unsigned long rounds)
+{
+    uint32_t rng = 0xC7A1U;
+    uint8_t frame[HDLC_MAX_FRAME_SIZE_BYTES];
+    unsigned long queued = 0;
+    uint16_t mostQueued = 0;
+    HostSyncInit();
+    for (unsigned long n = 0; n < rounds && testFailures == 0; n++)
+    {
+        uint16_t burst = 0;
+        for (;;)
+        {
+            // From an RR up to an XID
+            uint16_t len = testRandRange(&rng, 2U, 10U);
+            for (uint16_t i = 0; i < len; i++)
+            {
+                frame[i] = randFrameByte(&rng);
+            }
+            uint16_t start = syncTxCtrlHead;
+            if (!SyncAddTxCtrlFrame(frame, len, FRAME_SPACING))
+            {
+                break;
+            }
+            shadowBits(syncTxCtrlRing, txCtrlShadow, SYNC_TX_CTRL_BITS, start, syncTxCtrlHead);
+            burst++;
+        }
+        queued += burst;
+        if (burst > mostQueued)
+        {
+            mostQueued = burst;
+        }
+        // Keep a few main ring frames going for the control frames to slot in between
+        if (HostSyncTxUsed() < 512U)
+        {
+            uint16_t len = testRandRange(&rng, 2U, 64U);
+            for (uint16_t i = 0; i < len; i++)
+            {
+                frame[i] = randFrameByte(&rng);
+            }
+            uint16_t start = syncTxHead;
+            CHECK(SyncAddTxFrame(frame, len), "SyncAddTxFrame refused a %u byte frame", len);
+            shadowBits(syncTxRing, txShadow, SYNC_TX_RING_BITS, start, syncTxHead);
+        }
+        sendChecked(testRandRange(&rng, 1U, 64U));
+    }
+    CHECK(mostQueued >= 2U, "only %u control frames fit in the control ring at once", mostQueued);
+    printf("control ring: %lu frames queued, up to %u at once without draining\n", queued, mostQueued);
+}
+#endif
+
+/**
+ * @brief Time both paths for one frame size
+*/
+static void benchFrames(uint16_t len)
+{
+    uint8_t frame[HDLC_MAX_FRAME_SIZE_BYTES + 2U];
+    uint32_t rng = len;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        frame[i] = testRand(&rng);
+    }
+    unsigned long frames = 50000000UL / (len + 8U);
+
+    double start = testNow();
+    for (unsigned long n = 0; n < frames; n++)
+    {
+        OldSendFrame(frame, len);
+        oldTxTail = oldTxHead;
+    }
+    double oldSecs = testNow() - start;
+
+    start = testNow();
+    for (unsigned long n = 0; n < frames; n++)
+    {
+        SyncAddTxFrame(frame, len);
+        HostSyncTxDrain();
+    }
+    double newSecs = testNow() - start;
+
+    printf("  %3u bytes: %10.0f -> %10.0f frames/s\n", len, frames / oldSecs, frames / newSecs);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = testArgCount(argc, argv, 3000UL);
+    checkFrames(frames);
+    checkFullRing(frames * 4UL);
+    #ifdef HDLC_CTRL_FAST_LANE
+    checkCtrlFrames(frames * 4UL);
+    #endif
+
+    printf("throughput, old Crc16 + stuffing -> fused:\n");
+    for (uint8_t i = 0; i < sizeof(benchLens) / sizeof(benchLens[0]); i++)
+    {
+        benchFrames(benchLens[i]);
+    }
+
+    return testResult("tx_frame");
+}
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : bitstuff.h
+  * @brief          : Header for bitstuff.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BITSTUFF_H
+#define __BITSTUFF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of ones-run states tracked by the RX destuffer (0 through 6 consecutive 1s)
+#define DESTUFF_ONES_STATES     7U
+
+// Results of a single destuffer step
+enum DestuffResult {
+    DESTUFF_BIT = 0x00,     // bit is data and should be kept
+    DESTUFF_DROP = 0x01,    // bit was a stuffed zero and should be dropped
+    DESTUFF_ABORT = 0x02,   // 7 consecutive 1s were received
+};
+
+// Destuff table entry flags
+#define DESTUFF_FLAG_STUFFED    0x01    // a stuffed zero was dropped from this nibble
+#define DESTUFF_FLAG_ABORT      0x02    // 7 consecutive 1s were seen in this nibble, bits after it were discarded
+
+/**
+ * Result of running 4 raw line bits (LSB first) through the destuffer
+ *
+ * Only one stuffed bit can fit in a nibble, since it must be preceeded by five 1s
+*/
+typedef struct {
+    uint8_t bits;       // destuffed output bits, first received bit in bit 0
+    uint8_t count;      // number of valid output bits (0-4)
+    uint8_t ones;       // ones-run state after the nibble
+    uint8_t flags;      // DESTUFF_FLAG_x
+    uint8_t stuffPos;   // number of output bits preceeding the dropped stuffed bit
+} DestuffEntry_t;
+
+// Number of ones-run states tracked by the TX stuffer (0 through 4 consecutive 1s, a 5th is always followed by a stuffed 0)
+#define STUFF_ONES_STATES       5U
+
+/**
+ * Result of running 4 data bits (LSB first) through the stuffer
+ *
+ * Only one zero can be stuffed into a nibble, since the run resets after it
+*/
+typedef struct {
+    uint8_t bits;       // stuffed line bits, first to send in bit 0
+    uint8_t count;      // number of line bits (4 or 5)
+    uint8_t ones;       // ones-run state after the nibble
+} StuffEntry_t;
+
+extern DestuffEntry_t destuffTable[DESTUFF_ONES_STATES][16];
+extern StuffEntry_t stuffTable[STUFF_ONES_STATES][16];
+
+void BitStuffInit();
+uint8_t BitStuffRxStep(uint8_t *ones, uint8_t bit);
+bool BitStuffTxStep(uint8_t *ones, uint8_t bit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
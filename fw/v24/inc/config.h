@@ -36,8 +36,84 @@ extern "C" {
 // Interval in ms for the periodic status print
 #define PERIODIC_STATUS_INT 30000
 
+// Track the worst case cycles spent in the hot interrupt handlers with the DWT cycle counter (logged with the periodic status)
+//#define ISR_CYCLE_STATS
+
 // Report buffer space in 16-byte blocks instead of LDUs
 #define STATUS_SPACE_BLOCKS
+// Send the host a status message of our own when the reported space drops below STATUS_PUSH_LOW, and again when
+// it's back up to STATUS_PUSH_HIGH (both in the units above), so it doesn't have to poll to know when to send.
+// Off by default, as a host that doesn't expect unsolicited status messages may take one for a reply to its own poll
+//#define STATUS_PUSH
+#ifdef STATUS_SPACE_BLOCKS
+#define STATUS_PUSH_LOW     24U
+#define STATUS_PUSH_HIGH    48U
+#else
+#define STATUS_PUSH_LOW     1U
+#define STATUS_PUSH_HIGH    2U
+#endif
+
+// TX jitter buffer between the host and the V24 peer. P25 voice frames (one IMBE codeword, 20 ms each) are held
+// until TX_JITTER_TARGET of them are waiting, then played out one every 20 ms. Other frames go through in order
+// without waiting. The target goes up a frame after each underrun, to at most TX_JITTER_MAX, and voice frames that
+// arrive with TX_JITTER_MAX already waiting are dropped. Both depths can be changed with CMD_SET_TX_JITTER.
+// Off by default, since it adds TX_JITTER_TARGET frames of delay to every voice stream
+//#define TX_JITTER
+#define TX_JITTER_TARGET    3U
+#define TX_JITTER_MAX       18U
+// Share of the line left over by voice that TSBKs and other data (PDUs) get, in frames per turn
+#define TXQ_WEIGHT_TSBK     3U
+#define TXQ_WEIGHT_DATA     1U
+
+// Send link control frames (RR, UA, XID, SABM) from a TX ring of their own, which the sync engine switches to at the
+// next frame boundary, so replies don't wait behind the UI frames already queued
+#define HDLC_CTRL_FAST_LANE
+
+// Synchronous serial engine options
+// Capture RXD with TIM2-triggered DMA and deframe in blocks instead of sampling in the TIM2 interrupt
+//#define SYNC_RX_DMA
+// Drive TXCLK & TXD from a pre-rendered table of GPIO BSRR words moved by TIM2-triggered DMA
+//#define SYNC_TX_DMA
+// Shift RXD in with SPI1 as a receive-only slave clocked by RXCLK, and deframe whole bytes from its DMA buffer
+// (uses the same DMA channel as SYNC_RX_DMA, so only one of the two RX options can be enabled)
+//#define SYNC_RX_SPI
+
+// Oversample RXD with TIM3-triggered DMA, and sample at the bit centre tracked by a digital PLL (4, 8 or 16 samples per bit,
+// it takes 8 or more to ride out +/-0.2 bits of edge jitter)
+//#define SYNC_RX_OVERSAMPLE      8U
+// Follow a clock supplied on RXCLK (CLKSEL jumper removed) instead of generating our own, RX sampling and TX
+// bit updates happen on its edges and it's repeated out on TXCLK (can be combined with SYNC_RX_SPI)
+//#define SYNC_EXT_CLOCK
+
+#if defined(SYNC_RX_DMA) && defined(SYNC_RX_SPI)
+#error "SYNC_RX_DMA and SYNC_RX_SPI both use DMA1 channel 2, only one can be enabled"
+#endif
+#if defined(SYNC_RX_OVERSAMPLE) && (defined(SYNC_RX_DMA) || defined(SYNC_RX_SPI) || defined(SYNC_EXT_CLOCK))
+#error "SYNC_RX_OVERSAMPLE can't be combined with the other RX options or SYNC_EXT_CLOCK"
+#endif
+#if defined(SYNC_RX_OVERSAMPLE) && (SYNC_RX_OVERSAMPLE != 4U) && (SYNC_RX_OVERSAMPLE != 8U) && (SYNC_RX_OVERSAMPLE != 16U)
+#error "SYNC_RX_OVERSAMPLE must be 4, 8 or 16"
+#endif
+#if defined(SYNC_EXT_CLOCK) && (defined(SYNC_RX_DMA) || defined(SYNC_TX_DMA))
+#error "SYNC_RX_DMA and SYNC_TX_DMA are paced by our own TIM2 clock and can't be used with SYNC_EXT_CLOCK"
+#endif
+
+// FCS CRC kernel: CRC_KERNEL_BYTE (512 byte flash table) or CRC_KERNEL_NIBBLE (32 byte table, slower)
+//#define CRC_KERNEL              CRC_KERNEL_NIBBLE
+// Build all the CRC kernels, including the slice-by-2/4 ones only used for comparison, and time each one over a
+// test frame at startup
+//#define CRC_BENCHMARK
+
+// V2 host link (USART1 to the CP2102) rate at startup, and the rate it falls back to if the host goes quiet after
+// moving it to another rate with CMD_SET_HOST_BAUD
+#define VCP_BAUD_DEFAULT        115200U
+// USART1 RTS/CTS flow control on PA12/PA11, so a full RX ring holds the host off instead of being flushed. Stock V2
+// boards don't route these pins to the CP2102 (its RTS drives the boot jumper), so only enable this on a board
+// that's been wired for it
+//#define VCP_HW_FLOW_CONTROL
+#if defined(VCP_HW_FLOW_CONTROL) && defined(DVM_V24_V1)
+#error "VCP_HW_FLOW_CONTROL is for the V2 USART1 host link, PA11 & PA12 are the USB port on V1"
+#endif
 
 // STM32 Interrupt Priorities
 #define NVIC_PRI_TIM2           2U
@@ -45,6 +121,9 @@ extern "C" {
 #define NVIC_PRI_USART1_RX      4U
 #define NVIC_PRI_USART2_DMA     5U
 #define NVIC_PRI_USART2_INT     6U
+#define NVIC_PRI_SYNC_RX_DMA    5U
+#define NVIC_PRI_SYNC_TX_DMA    2U
+#define NVIC_PRI_SYNC_EXT_CLK   2U
 
 // Flash Areas (shamelessly stolen from dvmfirmware-hs)
 #define STM32_CNF_PAGE_ADDR     (uint32_t)0x0800FC00
@@ -69,7 +148,12 @@ extern "C" {
 // P25 Frame sizes
 #define P25_LDU_FRAME_LENGTH_BYTES      216U
 #define P25_V24_LDU_FRAME_LENGTH_BYTES  370U
-#define VCP_MAX_MSG_LENGTH_BYTES        255U
+
+// Largest HDLC frame (address, control & payload, without the FCS) that can be sent or received. The RX frame
+// slots, TX buffers and VCP message buffers are all sized from this.
+#define HDLC_MAX_FRAME_SIZE_BYTES       512U
+// Largest VCP message: a long frame header (start & 2 length bytes), command, pad, and a UI payload
+#define VCP_MAX_MSG_LENGTH_BYTES        (HDLC_MAX_FRAME_SIZE_BYTES + 3U)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file           : crc.h
+  * @brief          : Header for crc.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRC_H
+#define __CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "config.h"
+
+// Available CRC kernels
+#define CRC_KERNEL_BYTE     0   // one table lookup per byte (512 bytes of flash)
+#define CRC_KERNEL_NIBBLE   1   // two lookups per byte in a 16 entry table (32 bytes of flash)
+#define CRC_KERNEL_SLICE2   2   // one lookup per byte, 2 bytes per step (CRC_BENCHMARK only)
+#define CRC_KERNEL_SLICE4   3   // one lookup per byte, 4 bytes per step (CRC_BENCHMARK only)
+#define CRC_KERNEL_COUNT    4
+
+// Kernel used for everything (set CRC_KERNEL in config.h to change it)
+#ifndef CRC_KERNEL
+#define CRC_KERNEL          CRC_KERNEL_BYTE
+#endif
+#if (CRC_KERNEL != CRC_KERNEL_BYTE) && (CRC_KERNEL != CRC_KERNEL_NIBBLE)
+#error "CRC_KERNEL must be CRC_KERNEL_BYTE or CRC_KERNEL_NIBBLE, the FCS is calculated a byte at a time"
+#endif
+
+// CRC-16/X.25 initial value
+#define CRC16_CCITT_INIT_VAL 0xFFFF
+// CRC (before the final inversion) of any frame followed by its correct FCS
+#define CRC16_X25_RESIDUE   0xF0B8
+
+#if (CRC_KERNEL == CRC_KERNEL_NIBBLE)
+extern const uint16_t crcNibbleTable[16];
+#else
+extern const uint16_t crcTable[256];
+#endif
+
+void CrcInit();
+uint16_t CrcUpdate(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t Crc16(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Start a streaming CRC
+ * @return the initial CRC value
+*/
+static inline uint16_t CrcStart()
+{
+    return CRC16_CCITT_INIT_VAL;
+}
+
+/**
+ * @brief Run a single byte through the CRC, for callers that get their data a byte at a time
+ * @param crc running CRC
+ * @param byte next byte
+ * @return updated CRC
+*/
+static inline uint16_t CrcUpdateByte(uint16_t crc, uint8_t byte)
+{
+    #if (CRC_KERNEL == CRC_KERNEL_NIBBLE)
+    crc = (crc >> 4) ^ crcNibbleTable[(crc ^ byte) & 0xF];
+    return (crc >> 4) ^ crcNibbleTable[(crc ^ (byte >> 4)) & 0xF];
+    #else
+    return (crc >> 8) ^ crcTable[(crc ^ byte) & 0xFF];
+    #endif
+}
+
+/**
+ * @brief Finish a streaming CRC
+ * @param crc running CRC
+ * @return the FCS, in HDLC bit order (send the low byte first)
+*/
+static inline uint16_t CrcFinal(uint16_t crc)
+{
+    return crc ^ 0xFFFF;
+}
+
+#ifdef CRC_BENCHMARK
+typedef uint32_t (*CrcCycleFn_t)(void);
+extern const char *crcKernelNames[CRC_KERNEL_COUNT];
+uint16_t CrcUpdateKernel(uint8_t kernel, uint16_t crc, const uint8_t *data, uint16_t len);
+uint32_t CrcBenchmark(uint8_t kernel, const uint8_t *data, uint16_t len, CrcCycleFn_t cycles);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
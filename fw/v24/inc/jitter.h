@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : jitter.h
+  * @brief          : Header for jitter.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __JITTER_H
+#define __JITTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "txbuf.h"
+
+// Size of the ring the buffered frames are copied into (must be a power of 2), each frame takes 2 length bytes extra
+#define JITTER_BUF_LEN          1024U
+
+// Playout interval of a voice frame (one IMBE codeword)
+#define JITTER_FRAME_MS         20U
+
+// Time without a voice frame after which the stream is over, so the next voice frame starts a new one instead of
+// counting as late
+#define JITTER_STREAM_TIMEOUT   360U
+
+// Voice frames played without a late one before the target depth drops back by one towards the configured target
+#define JITTER_ADAPT_FRAMES     50U
+
+// Playout statistics
+extern uint8_t jitterTarget;
+extern uint32_t jitterPlayed;
+extern uint32_t jitterLate;
+extern uint32_t jitterEarly;
+extern uint32_t jitterUnderruns;
+
+void JitterReset();
+void JitterCallback();
+bool JitterPut(TxBuf_t *buf);
+bool JitterSetDepth(uint8_t target, uint8_t max);
+void JitterGetDepth(uint8_t *target, uint8_t *max);
+uint8_t JitterGetVoice();
+uint8_t JitterGetFrames();
+bool JitterActive();
+uint16_t JitterGetUsed();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef LEDS_H
 #define LEDS_H
 
+#include "util.h"
+
 // LED Command Defines
 #define LED_LINK(state)     HAL_GPIO_WritePin(LED_LINK_GPIO_Port, LED_LINK_Pin, state)
-#define LED_ACT(state)      HAL_GPIO_WritePin(LED_ACT_GPIO_Port, LED_ACT_Pin, state)
+// Activity LED is set from the sync ISR, so it's written through its bit-band alias
+#define LED_ACT(state)      (GPIO_BB_OUT(LED_ACT_GPIO_Port, LED_ACT_Pin) = (state))
 
 #ifdef DVM_V24_V1
 #define LED_HB(state)       HAL_GPIO_WritePin(LED_HB_GPIO_Port, LED_HB_Pin, state)
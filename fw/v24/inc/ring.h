@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : ring.h
+  * @brief          : Header for ring.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RING_H
+#define __RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__arm__)
+#include "stm32f1xx_hal.h"
+#define RING_BARRIER()  __DMB()
+#else
+// Host builds (acquire & release ordering is all the ring needs)
+#define RING_BARRIER()  __atomic_thread_fence(__ATOMIC_ACQ_REL)
+#endif
+
+/**
+ * A single producer, single consumer byte ring
+ *
+ * The producer only ever writes head and the consumer only ever writes tail, so one side can be an
+ * interrupt handler (or DMA completion) without any locking. Both indexes run freely and are masked
+ * on use, so the ring can be completely full and used bytes are always head - tail.
+*/
+typedef struct {
+    uint8_t * const buffer;
+    const uint16_t size;        // buffer size in bytes, must be a power of 2 (up to 32768)
+    volatile uint16_t head;     // total bytes written, only changed by the producer
+    volatile uint16_t tail;     // total bytes read, only changed by the consumer
+    volatile uint16_t highWater;// most bytes ever held at once, only changed by the producer
+} Ring_t;
+
+// Static initialiser for a ring over an array
+#define RING_INIT(buf)  { .buffer = (buf), .size = sizeof(buf), .head = 0, .tail = 0, .highWater = 0 }
+
+/**
+ * @brief Get the number of bytes waiting to be read
+*/
+static inline uint16_t RingUsed(const Ring_t *r)
+{
+    return (uint16_t)(r->head - r->tail);
+}
+
+/**
+ * @brief Get the number of bytes that can be written
+*/
+static inline uint16_t RingFree(const Ring_t *r)
+{
+    return r->size - RingUsed(r);
+}
+
+// Producer side
+bool RingPush(Ring_t *r, uint8_t data);
+bool RingWrite(Ring_t *r, const uint8_t *data, uint16_t len);
+uint16_t RingWriteSpan(Ring_t *r, uint8_t **span);
+void RingWriteCommit(Ring_t *r, uint16_t len);
+
+// Consumer side
+bool RingPop(Ring_t *r, uint8_t *data);
+bool RingPeek(const Ring_t *r, uint16_t offset, uint8_t *data);
+uint16_t RingRead(Ring_t *r, uint8_t *data, uint16_t len);
+uint16_t RingReadSpan(Ring_t *r, uint8_t **span);
+void RingReadCommit(Ring_t *r, uint16_t len);
+void RingClear(Ring_t *r);
+
+// Neither side running
+void RingReset(Ring_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,6 +29,9 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include "main.h"
+#include "ring.h"
+
+extern Ring_t serialTxFifo;
 
 // External functions
 void SerialCallback(UART_HandleTypeDef *huart);
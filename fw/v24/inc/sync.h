@@ -17,28 +17,60 @@ extern "C" {
 #include "stdint.h"
 #include "log.h"
 #include "main.h"
+#include "util.h"
+#include "hdlc.h"
 
 #define SYNC_TX_DELAY   32      // ms to wait once TX fifo has data before we start to send
 #define SYNC_RX_DELAY   1000    // ms to wait after startup/reset before starting RX sync routines
 
+#define SYNC_DEFAULT_LINE_RATE  9600U   // bps
+
+#define SYNC_RX_OS_SAMPLES      512U    // number of GPIO samples in the circular oversampled RX DMA buffer (half is processed per interrupt)
+#define SYNC_DPLL_KP_SHIFT      1       // each RXD transition moves the oversampling DPLL's phase 1/2^n of the way to it
+#define SYNC_DPLL_KI_SHIFT      11      // and trims its phase step by 1/2^n of the error
+
+#define SYNC_EVENT_SLOTS        16U     // sync events the interrupt handlers can queue for the main loop (must be a power of 2)
+
+#define SYNC_EXT_CLK_TIMEOUT    100U    // ms without external clock edges before it's considered lost
+#define SYNC_EXT_CLK_AVG_BITS   256U    // number of external clock periods averaged for the rate measurement
+
 // HDLC parameters
 #define HDLC_BIT_STUFFED    0x7C    // (b01111100) we skip the next bit in this case (we've received 5 1s in a row)
 #define HDLC_SYNC_WORD      0x7E    // (b01111110) we search for this while we bitshift our rx byte buffer
 #define HDLC_INVALID        0xFE    // (b01111111) this should never happen and we should throw ourselves out of sync if we see it
-#define HDLC_ESCAPE_CODE    0x7D    // This is used to escape bytes
-#define HDLC_ESCAPE_7E      0x5E    // Follows the escape code to escape a 0x7E
-#define HDLC_ESCAPE_7D      0x5D    // Follows the escape code to escape a 0x7D
 
-#define SYNC_RX_BUF_LEN (P25_V24_LDU_FRAME_LENGTH_BYTES * 3)
-#define SYNC_TX_BUF_LEN (P25_V24_LDU_FRAME_LENGTH_BYTES * 3)
+// Number of RX frame slots the ISR deframes into (must be a power of 2), and the largest frame including its FCS
+#define SYNC_RX_SLOTS       4U
+#define SYNC_RX_FRAME_MAX   (HDLC_MAX_FRAME_SIZE_BYTES + 2U)
+
+// Size of the TX ring of stuffed line bits, in 32-bit words (must be a power of 2)
+#define SYNC_TX_RING_WORDS  512U
+#define SYNC_TX_RING_BITS   (SYNC_TX_RING_WORDS * 32U)
+
+// Number of GPIO samples in the circular RX DMA capture buffer (2 samples per bit, half is processed per interrupt)
+#define SYNC_RX_DMA_SAMPLES 256U
+
+// Size of the TX ring of stuffed link control frames, in 32-bit words (must be a power of 2), enough for a few XIDs
+#define SYNC_TX_CTRL_WORDS  16U
+#define SYNC_TX_CTRL_BITS   (SYNC_TX_CTRL_WORDS * 32U)
+// Frame ends in the main TX ring the ISR can switch to the control ring at (must be a power of 2, up to 128)
+#define SYNC_TX_MARKS       32U
+
+// Number of line bytes in the circular SPI RX DMA buffer (half is deframed per interrupt)
+#define SYNC_RX_SPI_BYTES   16U
+
+// Number of bits in the TX DMA waveform table (2 BSRR words per bit, half is refilled per interrupt)
+#define SYNC_TX_DMA_BITS    64U
+// Timer ticks after each update that the TX DMA writes the pins, so RX captures see the pins before they change
+#define SYNC_TX_DMA_OFFSET  16U
 
-// Pin Definitions (pin names are labelled in STM32CubeMX projet)
-#define GET_RXCLK(state)    HAL_GPIO_ReadPin(DCE_RXCLK_GPIO_Port, DCE_RXCLK_Pin)
-#define GET_RXD()           HAL_GPIO_ReadPin(DCE_RXD_GPIO_Port, DCE_RXD_Pin)
-#define GET_CTS()           HAL_GPIO_ReadPin(DCE_CTS_GPIO_Port, DCE_CTS_Pin)
-#define SET_TXCLK(state)    HAL_GPIO_WritePin(DCE_TXCLK_GPIO_Port, DCE_TXCLK_Pin, state)
-#define SET_TXD(state)      HAL_GPIO_WritePin(DCE_TXD_GPIO_Port, DCE_TXD_Pin, state)
-#define SET_CTS(state)      HAL_GPIO_WritePin(DCE_CTS_GPIO_Port, DCE_CTS_Pin, state)
+// Pin Definitions (pin names are labelled in STM32CubeMX projet), bit-band aliases since these are used every bit
+#define GET_RXCLK()         GPIO_BB_IN(DCE_RXCLK_GPIO_Port, DCE_RXCLK_Pin)
+#define GET_RXD()           GPIO_BB_IN(DCE_RXD_GPIO_Port, DCE_RXD_Pin)
+#define GET_CTS()           GPIO_BB_IN(DCE_CTS_GPIO_Port, DCE_CTS_Pin)
+#define SET_TXCLK(state)    (GPIO_BB_OUT(DCE_TXCLK_GPIO_Port, DCE_TXCLK_Pin) = (state))
+#define SET_TXD(state)      (GPIO_BB_OUT(DCE_TXD_GPIO_Port, DCE_TXD_Pin) = (state))
+#define SET_CTS(state)      (GPIO_BB_OUT(DCE_CTS_GPIO_Port, DCE_CTS_Pin) = (state))
 
 #define TXCLK_HIGH()    SET_TXCLK(1)
 #define TXCLK_LOW()     SET_TXCLK(0)
@@ -47,6 +79,35 @@ extern unsigned long rxValidFrames;
 extern unsigned long rxTotalFrames;
 extern unsigned long txTotalFrames;
 
+/**
+ * A timer update rate synthesized from whole timer ticks, with the leftover carried between updates
+*/
+typedef struct {
+    TIM_TypeDef *tim;   // timer to set the period of
+    uint16_t period;    // whole timer ticks per update
+    uint32_t frac;      // leftover timer clock per update, out of div
+    uint32_t div;       // updates per second
+    uint32_t acc;       // accumulated leftover, an extra tick is added once it reaches a whole one
+} SyncClk_t;
+
+// Events posted from interrupt context, the logging/VCP/reset work for them runs in SyncEventCallback
+enum SyncEvent {
+    SYNC_EVT_RX_START = 0x01,   // RX startup/reset delay elapsed
+    SYNC_EVT_RX_SYNCED,         // first flag found, RX is synced
+    SYNC_EVT_RX_ABORT,          // 7 consecutive 1s received
+    SYNC_EVT_RX_BAD_STATE,      // deframer found itself in an invalid state (arg is the state)
+    SYNC_EVT_RX_NO_SLOT,        // received frames were dropped because the main loop hadn't freed a frame slot
+    SYNC_EVT_RX_TOO_LONG,       // a received frame overran its slot and was dropped
+};
+
+/**
+ * A fixed size event record in the ISR to main loop mailbox
+*/
+typedef struct {
+    uint8_t code;       // enum SyncEvent
+    uint32_t arg;       // event specific value
+} SyncEvent_t;
+
 // State machine stuff
 enum RxState {
     INIT = 0x00,
@@ -56,14 +117,34 @@ enum RxState {
 
 extern volatile enum RxState SyncRxState;
 
+extern volatile uint32_t syncTimerOverruns;
+extern volatile uint32_t syncRxOverruns;
+extern volatile uint32_t syncTxOverruns;
+
+extern volatile uint32_t syncEventsLost;
+extern volatile uint32_t syncRxFrameDrops;
+
+extern volatile uint32_t syncDpllTransitions;
+extern volatile uint32_t syncDpllAhead;
+extern volatile uint32_t syncDpllBehind;
+extern volatile uint32_t syncDpllErrSum;
+
 void SyncStartup(TIM_HandleTypeDef *tim);
 void SyncReset();
 void SyncTimerCallback(void);
-bool SyncAddTxByte(const uint8_t byte);
-bool SyncAddTxBytes(const uint8_t *bytes, unsigned int len);
-uint8_t SyncGetTxFree();
+void SyncClockEdge(void);
+void SyncClockCallback();
+void SyncEventCallback();
+void SyncRxDeframe(uint8_t bits);
+bool SyncAddTxFrame(const uint8_t *data, uint16_t len);
+bool SyncAddTxFlags(uint8_t count);
+bool SyncAddTxCtrlFrame(const uint8_t *data, uint16_t len, uint8_t flags);
+uint16_t SyncGetTxMark(bool ctrl);
+bool SyncTxMarkSent(bool ctrl, uint16_t mark);
+uint16_t SyncGetTxFreeBits();
+bool SyncSetLineRate(uint32_t rate);
+uint32_t SyncGetLineRate();
 void RxMessageCallback();
-uint16_t StuffByte(uint8_t byte);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : txbuf.h
+  * @brief          : Header for txbuf.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TXBUF_H
+#define __TXBUF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hdlc.h"
+
+// Number of TX frame buffers in the pool
+#define TXBUF_COUNT     4U
+// Room kept in front of the payload for the HDLC address & control bytes (the FCS is added as the frame is bit stuffed)
+#define TXBUF_HEADROOM  2U
+// A buffer holds a whole frame, including the head room
+#define TXBUF_SIZE      HDLC_MAX_FRAME_SIZE_BYTES
+
+/**
+ * A TX frame buffer, owned by whoever last got it from TxBufAlloc until they free it or hand it on
+ *
+ * The frame is data[start] to data[start + len - 1], and can grow into the head room or towards the end of the buffer
+*/
+typedef struct TxBuf {
+    uint8_t data[TXBUF_SIZE];
+    uint16_t start;     // offset of the first frame byte
+    uint16_t len;       // number of frame bytes
+    bool used;          // allocated from the pool
+} TxBuf_t;
+
+TxBuf_t *TxBufAlloc();
+void TxBufFree(TxBuf_t *buf);
+uint8_t *TxBufPrepend(TxBuf_t *buf, uint16_t n);
+uint8_t *TxBufAppend(TxBuf_t *buf, uint16_t n);
+
+/**
+ * @brief Get a pointer to the first frame byte
+*/
+static inline uint8_t *TxBufData(TxBuf_t *buf)
+{
+    return &buf->data[buf->start];
+}
+
+/**
+ * @brief Append a single byte to the frame
+ * @return false if there's no room left
+*/
+static inline bool TxBufPutByte(TxBuf_t *buf, uint8_t byte)
+{
+    if ((uint32_t)buf->start + buf->len >= TXBUF_SIZE)
+    {
+        return false;
+    }
+    buf->data[buf->start + buf->len++] = byte;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
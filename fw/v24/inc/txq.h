@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : txq.h
+  * @brief          : Header for txq.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TXQ_H
+#define __TXQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "txbuf.h"
+
+// Sizes of the rings the TSBK & other data frames are queued in (must be powers of 2), each frame takes 2 length
+// bytes extra. Voice streams are queued in the jitter buffer.
+#define TXQ_TSBK_BUF_LEN        256U
+#define TXQ_DATA_BUF_LEN        1024U
+
+// TSBK & other data frames are only handed to the HDLC layer while the sync TX ring holds less than this many line
+// bits (about 33 ms at 9600 bps), so a burst of them can't build up a backlog in front of the next voice frame
+#define TXQ_DATA_BACKLOG_BITS   320U
+
+// First byte of the V.24 UI payloads
+#define P25_V24_START_STOP      0x00U   // start/end of stream record
+#define P25_V24_VHDR_1          0x60U   // voice header, part 1
+#define P25_V24_VHDR_2          0x61U   // voice header, part 2
+#define P25_V24_VOICE_FIRST     0x62U   // LDU1 (0x62-0x6A) & LDU2 (0x6B-0x73) IMBE records
+#define P25_V24_VOICE_LAST      0x73U
+#define P25_V24_TSBK            0xA1U   // trunking signalling block
+
+// Traffic classes, in priority order
+enum TxqClass {
+    TXQ_VOICE = 0,      // IMBE records, played out by the jitter buffer
+    TXQ_STREAM,         // start/end of stream & voice header records, kept in order with the voice around them
+    TXQ_TSBK,           // trunking signalling
+    TXQ_DATA,           // PDUs and anything else
+    TXQ_CLASSES
+};
+
+// Frames accepted and dropped per class (voice frames dropped by the jitter buffer are counted as jitterEarly)
+extern uint32_t txqQueued[TXQ_CLASSES];
+extern uint32_t txqDrops[TXQ_CLASSES];
+
+/**
+ * @brief Get the class of a UI payload from its first byte
+*/
+static inline uint8_t TxqClassify(uint8_t type)
+{
+    if (type >= P25_V24_VOICE_FIRST && type <= P25_V24_VOICE_LAST)
+    {
+        return TXQ_VOICE;
+    }
+    if (type == P25_V24_START_STOP || type == P25_V24_VHDR_1 || type == P25_V24_VHDR_2)
+    {
+        return TXQ_STREAM;
+    }
+    if (type == P25_V24_TSBK)
+    {
+        return TXQ_TSBK;
+    }
+    return TXQ_DATA;
+}
+
+void TxqReset();
+void TxqCallback();
+bool TxqPut(TxBuf_t *buf);
+uint8_t TxqGetDepth(uint8_t cls);
+uint16_t TxqGetUsed();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,7 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include "log.h"
+#include "config.h"
 
 // this converts to string
 #define STR_(X) #X
@@ -26,6 +27,34 @@ extern "C" {
 
 #define STM32_UUID ((uint32_t *)0x1FFFF7E8)
 
+// Cortex-M3 bit-band alias for a single bit of a peripheral register (mask must be a single bit), so the bit
+// can be read or written on its own in one access without a read-modify-write in software
+#define BITBAND_PERIPH(reg, mask)   (*(volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)&(reg) - PERIPH_BASE) * 32U) + (__builtin_ctz(mask) * 4U)))
+// GPIO output/input bit of a single pin
+#define GPIO_BB_OUT(port, pin)      BITBAND_PERIPH((port)->ODR, pin)
+#define GPIO_BB_IN(port, pin)       BITBAND_PERIPH((port)->IDR, pin)
+
+// Interrupt handlers whose worst case cycle counts are tracked with ISR_CYCLE_STATS
+enum IsrCycleSlot {
+    ISR_CYC_TIM2 = 0,
+    ISR_CYC_EXTI3,
+    ISR_CYC_USART1,
+    ISR_CYC_USART2,
+    ISR_CYC_SYNC_TX_DMA,
+    ISR_CYC_SYNC_RX_DMA,
+    ISR_CYC_COUNT
+};
+
+#ifdef ISR_CYCLE_STATS
+extern volatile uint32_t isrCyclesMax[ISR_CYC_COUNT];
+// Put at the top of a handler, and ISR_CYCLES_END before every return
+#define ISR_CYCLES_START()      uint32_t isrCycStart = DWT->CYCCNT
+#define ISR_CYCLES_END(slot)    do { uint32_t isrCyc = DWT->CYCCNT - isrCycStart; if (isrCyc > isrCyclesMax[slot]) { isrCyclesMax[slot] = isrCyc; } } while (0)
+#else
+#define ISR_CYCLES_START()
+#define ISR_CYCLES_END(slot)
+#endif
+
 typedef struct {
     uint8_t const buffer;
     int head;
@@ -33,14 +62,17 @@ typedef struct {
     const int maxlen;
 } CircularBuffer_t;
 
-void HexArrayToStr(char *buf, uint8_t *array, uint8_t len);
+void HexArrayToStr(char *buf, uint8_t *array, uint16_t len);
 bool GetBitAtPos(uint8_t byte, uint8_t pos);
 uint8_t SetBitAtPos(uint8_t byte, uint8_t pos, bool value);
-void printHexArray(char *outBuf, uint8_t *array, uint8_t len);
+void printHexArray(char *outBuf, uint8_t *array, uint16_t len);
 unsigned char reverseBits(unsigned char b);
 void getUid(uint8_t* buffer);
 void getUidString(char *str);
 void getCPU();
+void IsrCyclesInit();
+void IsrCyclesLog(uint32_t tim2Budget);
+void CrcBenchmarkLog();
 
 #ifdef __cplusplus
 }
@@ -18,17 +18,20 @@ extern "C" {
 #include "main.h"
 #include "log.h"
 #include "sync.h"
+#include "ring.h"
 
-#define VCP_RX_BUF_LEN      (P25_V24_LDU_FRAME_LENGTH_BYTES * 4)
-#define VCP_TX_BUF_LEN      (P25_V24_LDU_FRAME_LENGTH_BYTES * 2)
+// Ring sizes (must be powers of 2), a bit over 5 and 2.5 V24 LDUs
+#define VCP_RX_BUF_LEN      2048U
+#define VCP_TX_BUF_LEN      1024U
 
 // a 255-byte RS232 mesasge should take around 25ms ideally, but it seems to sometimes take much longer for a full message to make its way through
 #define VCP_RX_TIMEOUT      100
 #define VCP_TX_TIMEOUT      100
 
-#define USB_ENUM(state)     HAL_GPIO_WritePin(USB_ENUM_GPIO_Port, USB_ENUM_Pin, state)
+// Time after the host's last message at a rate other than VCP_BAUD_DEFAULT before we fall back to the default
+#define VCP_BAUD_FALLBACK_TIMEOUT   1000
 
-#define USB_TX_RETRIES      3
+#define USB_ENUM(state)     HAL_GPIO_WritePin(USB_ENUM_GPIO_Port, USB_ENUM_Pin, state)
 
 // DVM Serial Protocol Defines
 enum DVM_COMMANDS {
@@ -45,6 +48,13 @@ enum DVM_COMMANDS {
     CMD_NAK                 = 0x7F,
     CMD_FLASH_READ          = 0xE0,
     CMD_FLASH_WRITE         = 0xE1,
+    CMD_SET_LINE_RATE       = 0xE2,
+    CMD_GET_LINE_STATUS     = 0xE3,
+    CMD_SET_HOST_BAUD       = 0xE4,
+    CMD_SET_TX_JITTER       = 0xE5,
+    CMD_GET_TX_JITTER       = 0xE6,
+    CMD_GET_TX_QUEUES       = 0xE7,
+    CMD_GET_LINK_LATENCY    = 0xE8,
     CMD_RESET_MCU           = 0xEA,
     CMD_DEBUG1              = 0xF1,
     CMD_DEBUG2              = 0xF2,
@@ -93,14 +103,20 @@ enum DVM_STATE {
     STATE_P25 = 2U,                     //! Project 25
 };
 
+extern Ring_t vcpRxFifo;
+extern Ring_t vcpTxFifo;
+
 #ifdef DVM_V24_V1
 void VCPEnumerate();
-void VCPRxITCallback(uint8_t* buf, uint32_t len);
+bool VCPRxITCallback(uint8_t* buf, uint32_t len);
+void VCPUsbTxComplete();
+void VCPUsbReset();
 #else
 void VCPTxComplete();
 #endif
 
 void VCPRxCallback();
+void VCPStatusCallback();
 void VCPTxCallback();
 
 bool VCPWrite(uint8_t *data, uint16_t len);
@@ -110,9 +126,18 @@ bool VCPWriteP25Frame(const uint8_t *data, uint16_t len);
 
 void sendVersion();
 void sendStatus();
+uint8_t setLineRate(const uint8_t* data, uint16_t length);
+void sendLineStatus();
+void sendTxQueues();
+void sendLinkLatency();
+#ifdef TX_JITTER
+uint8_t setTxJitter(const uint8_t* data, uint16_t length);
+void sendTxJitter();
+#endif
 #ifndef DVM_V24_V1
 void flashRead();
-uint8_t flashWrite(const uint8_t* data, uint8_t length);
+uint8_t flashWrite(const uint8_t* data, uint16_t length);
+uint8_t setHostBaud(const uint8_t* data, uint16_t length, uint32_t *baud);
 #endif
 
 bool VCPWriteDebug1(const char *text);
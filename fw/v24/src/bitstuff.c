@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file           : bitstuff.c
+  * @brief          : Lookup-table based HDLC bit stuffing/destuffing
+  *
+  * The tables are built once at startup from the same single-bit rules the
+  * original per-bit RX state machine used, so the two can never disagree.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "bitstuff.h"
+
+// RX destuff table, indexed by [ones-run state][raw nibble]
+DestuffEntry_t destuffTable[DESTUFF_ONES_STATES][16];
+// TX stuff table, indexed by [ones-run state][data nibble]
+StuffEntry_t stuffTable[STUFF_ONES_STATES][16];
+
+/**
+ * @brief Run a single received bit through the destuffer
+ *
+ * @param *ones current count of consecutive 1s, updated in place
+ * @param bit received bit (0 or 1)
+ *
+ * @return DESTUFF_BIT if the bit is data, DESTUFF_DROP if it was a stuffed zero, DESTUFF_ABORT on 7 consecutive 1s
+*/
+uint8_t BitStuffRxStep(uint8_t *ones, uint8_t bit)
+{
+    // If we've received 5 1s and the next bit is 0, that's a stuffed bit and we should ignore it
+    if (*ones == 5 && bit == 0)
+    {
+        *ones = 0;
+        return DESTUFF_DROP;
+    }
+    // If we've received 6 1s and the next bit is also a 1, that can't happen normally
+    if (*ones == 6 && bit == 1)
+    {
+        return DESTUFF_ABORT;
+    }
+    // Otherwise count the ones and keep the bit
+    if (bit) { *ones += 1; } else { *ones = 0; }
+    return DESTUFF_BIT;
+}
+
+/**
+ * @brief Run a single data bit through the stuffer
+ *
+ * @param *ones current count of consecutive 1s, updated in place
+ * @param bit data bit to send (0 or 1)
+ *
+ * @return true if a stuffed zero needs to be sent after this bit
+*/
+bool BitStuffTxStep(uint8_t *ones, uint8_t bit)
+{
+    if (!bit)
+    {
+        *ones = 0;
+        return false;
+    }
+    // After 5 1s in a row we insert a 0 so the data can never look like a flag
+    *ones += 1;
+    if (*ones == 5)
+    {
+        *ones = 0;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Build the RX destuff table for every ones-run state and raw nibble
+*/
+static void buildDestuffTable()
+{
+    for (uint8_t state = 0; state < DESTUFF_ONES_STATES; state++)
+    {
+        for (uint8_t nibble = 0; nibble < 16; nibble++)
+        {
+            DestuffEntry_t entry = { 0 };
+            uint8_t ones = state;
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                uint8_t bit = (nibble >> i) & 0x1;
+                uint8_t res = BitStuffRxStep(&ones, bit);
+                if (res == DESTUFF_ABORT)
+                {
+                    // Anything after an abort is thrown away by the receiver
+                    entry.flags |= DESTUFF_FLAG_ABORT;
+                    break;
+                }
+                else if (res == DESTUFF_DROP)
+                {
+                    entry.flags |= DESTUFF_FLAG_STUFFED;
+                    entry.stuffPos = entry.count;
+                }
+                else
+                {
+                    entry.bits |= bit << entry.count;
+                    entry.count++;
+                }
+            }
+            entry.ones = ones;
+            destuffTable[state][nibble] = entry;
+        }
+    }
+}
+
+/**
+ * @brief Build the TX stuff table for every ones-run state and data nibble
+*/
+static void buildStuffTable()
+{
+    for (uint8_t state = 0; state < STUFF_ONES_STATES; state++)
+    {
+        for (uint8_t nibble = 0; nibble < 16; nibble++)
+        {
+            StuffEntry_t entry = { 0 };
+            uint8_t ones = state;
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                uint8_t bit = (nibble >> i) & 0x1;
+                entry.bits |= bit << entry.count;
+                entry.count++;
+                // Stuffed zero, nothing to set
+                if (BitStuffTxStep(&ones, bit))
+                {
+                    entry.count++;
+                }
+            }
+            entry.ones = ones;
+            stuffTable[state][nibble] = entry;
+        }
+    }
+}
+
+/**
+ * @brief Generate the bit stuffing lookup tables, must be called before the sync engine starts
+*/
+void BitStuffInit()
+{
+    buildDestuffTable();
+    buildStuffTable();
+}
@@ -0,0 +1,229 @@
+/**
+  ******************************************************************************
+  * @file           : crc.c
+  * @brief          : CRC-16/X.25 (HDLC FCS) kernels
+  *
+  * Only the kernel picked with CRC_KERNEL is built in normally, so only its
+  * table takes up space. The FCS is calculated a byte at a time as frames are
+  * stuffed & deframed, so the slice kernels, which need whole blocks, are only
+  * built with CRC_BENCHMARK to be timed against the others. This file has no
+  * HAL dependencies and builds on a host.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "crc.h"
+
+#if defined(CRC_BENCHMARK) || (CRC_KERNEL != CRC_KERNEL_NIBBLE)
+#define CRC_USE_BYTE
+#endif
+#if defined(CRC_BENCHMARK) || (CRC_KERNEL == CRC_KERNEL_NIBBLE)
+#define CRC_USE_NIBBLE
+#endif
+#ifdef CRC_BENCHMARK
+#define CRC_USE_SLICE
+#endif
+
+#ifdef CRC_USE_BYTE
+/**
+ * Bytewise CRC16 table, also the first table of the slice kernels
+ * Generated using: https://github.com/ETLCPP/crc-table-generator
+ * Using CRC16-X25 settings (1021, input & output reveral)
+*/
+const uint16_t crcTable[256] = {
+    0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF, 0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+    0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E, 0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+    0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD, 0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+    0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C, 0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+    0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB, 0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+    0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A, 0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+    0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9, 0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+    0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738, 0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+    0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7, 0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+    0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036, 0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+    0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5, 0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+    0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134, 0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+    0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3, 0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+    0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232, 0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+    0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1, 0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+    0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330, 0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78
+};
+
+#endif
+
+#ifdef CRC_USE_NIBBLE
+// CRC16-X25 of each 4 bit value, for the nibble kernel
+const uint16_t crcNibbleTable[16] = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387, 0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F
+};
+#endif
+
+#ifdef CRC_USE_SLICE
+// Tables for the bytes further back in each slice (crcTable is the first), built by CrcInit
+uint16_t crcSliceTable[3][256];
+#endif
+
+/**
+ * @brief Build the slice kernel tables, must be called before the CRC is used (does nothing without CRC_BENCHMARK)
+*/
+void CrcInit()
+{
+    #ifdef CRC_USE_SLICE
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        uint16_t crc = crcTable[i];
+        for (uint8_t t = 0; t < 3; t++)
+        {
+            // Each table is the one before it, run through one more zero byte
+            crc = (crc >> 8) ^ crcTable[crc & 0xFF];
+            crcSliceTable[t][i] = crc;
+        }
+    }
+    #endif
+}
+
+#ifdef CRC_USE_BYTE
+static uint16_t crcUpdateByteTable(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    while (len--)
+    {
+        crc = (crc >> 8) ^ crcTable[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+#endif
+
+#ifdef CRC_USE_NIBBLE
+static uint16_t crcUpdateNibble(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    while (len--)
+    {
+        uint8_t byte = *data++;
+        crc = (crc >> 4) ^ crcNibbleTable[(crc ^ byte) & 0xF];
+        crc = (crc >> 4) ^ crcNibbleTable[(crc ^ (byte >> 4)) & 0xF];
+    }
+    return crc;
+}
+#endif
+
+#ifdef CRC_USE_SLICE
+static uint16_t crcUpdateSlice2(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    while (len >= 2)
+    {
+        crc ^= data[0] | (data[1] << 8);
+        crc = crcSliceTable[0][crc & 0xFF] ^ crcTable[crc >> 8];
+        data += 2;
+        len -= 2;
+    }
+    if (len)
+    {
+        crc = (crc >> 8) ^ crcTable[(crc ^ *data) & 0xFF];
+    }
+    return crc;
+}
+
+static uint16_t crcUpdateSlice4(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    while (len >= 4)
+    {
+        crc ^= data[0] | (data[1] << 8);
+        crc = crcSliceTable[2][crc & 0xFF] ^ crcSliceTable[1][crc >> 8] ^ crcSliceTable[0][data[2]] ^ crcTable[data[3]];
+        data += 4;
+        len -= 4;
+    }
+    while (len--)
+    {
+        crc = (crc >> 8) ^ crcTable[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+#endif
+
+/**
+ * @brief Run a block of data through the CRC with the configured kernel
+ * @param crc running CRC (from CrcStart or a previous update)
+ * @param *data pointer to the data
+ * @param len number of bytes
+ * @return updated CRC
+*/
+uint16_t CrcUpdate(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    #if (CRC_KERNEL == CRC_KERNEL_NIBBLE)
+    return crcUpdateNibble(crc, data, len);
+    #else
+    return crcUpdateByteTable(crc, data, len);
+    #endif
+}
+
+/**
+ * @brief Calculate the FCS of a whole frame
+ * @param *data pointer to the frame
+ * @param len number of bytes
+ * @return FCS value, properly reversed for HDLC order
+ *
+ * Handy calculator for reference:
+ * http://www.sunshine2k.de/coding/javascript/crc/crc_js.html
+ * (use CRC16_X_25 preset)
+*/
+uint16_t Crc16(const uint8_t *data, uint16_t len)
+{
+    return CrcFinal(CrcUpdate(CrcStart(), data, len));
+}
+
+#ifdef CRC_BENCHMARK
+
+const char *crcKernelNames[CRC_KERNEL_COUNT] = { "byte", "nibble", "slice-by-2", "slice-by-4" };
+
+/**
+ * @brief Run a block of data through the CRC with any kernel
+ * @param kernel CRC_KERNEL_x
+ * @param crc running CRC
+ * @param *data pointer to the data
+ * @param len number of bytes
+ * @return updated CRC
+*/
+uint16_t CrcUpdateKernel(uint8_t kernel, uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    switch (kernel)
+    {
+        case CRC_KERNEL_NIBBLE: return crcUpdateNibble(crc, data, len);
+        case CRC_KERNEL_SLICE2: return crcUpdateSlice2(crc, data, len);
+        case CRC_KERNEL_SLICE4: return crcUpdateSlice4(crc, data, len);
+        default:                return crcUpdateByteTable(crc, data, len);
+    }
+}
+
+/**
+ * @brief Time a kernel over a block of data
+ *
+ * The best of several runs is kept, so interrupts or cache misses (on a host) during one run don't count
+ *
+ * @param kernel CRC_KERNEL_x
+ * @param *data pointer to the data
+ * @param len number of bytes
+ * @param cycles function returning a free running cycle count (DWT->CYCCNT on target)
+ * @return cycles taken for the whole block, or 0 if the kernel gave a different CRC to the bytewise one
+*/
+uint32_t CrcBenchmark(uint8_t kernel, const uint8_t *data, uint16_t len, CrcCycleFn_t cycles)
+{
+    uint16_t expected = crcUpdateByteTable(CRC16_CCITT_INIT_VAL, data, len);
+    uint32_t best = UINT32_MAX;
+    for (uint8_t run = 0; run < 8; run++)
+    {
+        uint32_t start = cycles();
+        uint16_t crc = CrcUpdateKernel(kernel, CRC16_CCITT_INIT_VAL, data, len);
+        uint32_t taken = cycles() - start;
+        if (crc != expected)
+        {
+            return 0;
+        }
+        if (taken < best)
+        {
+            best = taken;
+        }
+    }
+    return best;
+}
+
+#endif
@@ -13,6 +13,10 @@
 #include "string.h"
 #include "util.h"
 #include "vcp.h"
+#include "txbuf.h"
+#include "serial.h"
+#include "jitter.h"
+#include "txq.h"
 
 // Timers for various events
 unsigned long hdlcLastRx = 0;
@@ -25,39 +29,68 @@ uint8_t peerAddress = 0x0;
 
 bool HDLCPeerConnected = false;
 
+// SABM to UA and XID to XID latencies
+HdlcLatency_t hdlcLatency[HDLC_LAT_TYPES];
+
+void HdlcReset()
+{
+    // Replies still waiting to go out have been thrown away with the TX ring
+    for (uint8_t i = 0; i < HDLC_LAT_TYPES; i++)
+    {
+        hdlcLatency[i].pending = false;
+    }
+    if (HDLCPeerConnected)
+    {
+        HDLCPeerConnected = false;
+        log_info("HDLC reset");
+        VCPWriteDebug1("HDLC reset");
+    }
+}
+
 /**
- * @brief Calculate FCS for data array
- * @param *data pointer to data array
- * @param crc seed for CRC generation
- * @param len length of data array
- * @return FCS value, properly reversed for HDLC order
- * 
- * adapted from 
- * https://stackoverflow.com/questions/59966346/how-should-i-implement-crc-for-hdlc-crc16-ccitt
+ * @brief Start timing the reply to a link control request, once the reply has been queued
  * 
- * Handy calculator for reference:
- * http://www.sunshine2k.de/coding/javascript/crc/crc_js.html
- * (use CRC16_X_25 preset)
+ * @param lat latency record for the exchange
+ * @param rxTick HAL tick the request came in
 */
-uint16_t crc16(const uint8_t *data, uint8_t len)
+static void hdlcLatencyStart(HdlcLatency_t *lat, uint32_t rxTick)
 {
-    uint16_t crc = 0xFFFF;
-    while (len--)
+    // Only one reply is timed at a time, a repeated request before it's gone out isn't timed
+    if (lat->pending)
     {
-        crc = (crc >> 8) ^ crcTable[(crc^*data++)&0xFF];
+        return;
     }
-    crc ^= 0xFFFF;
-    return crc;
+    #ifdef HDLC_CTRL_FAST_LANE
+    lat->ctrl = true;
+    #else
+    lat->ctrl = false;
+    #endif
+    lat->mark = SyncGetTxMark(lat->ctrl);
+    lat->rxTick = rxTick;
+    lat->pending = true;
 }
 
-void HdlcReset()
+/**
+ * @brief Finish timing a reply if it's all gone out on the line
+ * @param lat latency record for the exchange
+*/
+static void hdlcLatencyCheck(HdlcLatency_t *lat)
 {
-    if (HDLCPeerConnected)
+    if (!lat->pending || !SyncTxMarkSent(lat->ctrl, lat->mark))
     {
-        HDLCPeerConnected = false;
-        log_info("HDLC reset");
-        VCPWriteDebug1("HDLC reset");
+        return;
     }
+    lat->pending = false;
+    lat->last = HAL_GetTick() - lat->rxTick;
+    if (lat->last > lat->max)
+    {
+        lat->max = lat->last;
+    }
+    lat->sum += lat->last;
+    lat->count++;
+    #ifdef DEBUG_HDLC
+    log_debug("Link control reply went out %lu ms after the request", lat->last);
+    #endif
 }
 
 /**
@@ -65,6 +98,11 @@ void HdlcReset()
 */
 void HdlcCallback()
 {
+    for (uint8_t i = 0; i < HDLC_LAT_TYPES; i++)
+    {
+        hdlcLatencyCheck(&hdlcLatency[i]);
+    }
+
     if (SyncRxState == SYNCED)
     {
         // RX timeout handler to reset if we haven't received a message in time
@@ -108,73 +146,97 @@ void HdlcCallback()
             log_warn("HDLC frame sync lost");
             VCPWriteDebug1("HDLC frame sync lost");
         }
+        // Let us know if the sync engine can't keep up with the line rate
+        if (syncTimerOverruns || syncRxOverruns || syncTxOverruns)
+        {
+            log_warn("Sync overruns at %lu bps: [TIM: %lu, RX: %lu, TX: %lu]", SyncGetLineRate(), syncTimerOverruns, syncRxOverruns, syncTxOverruns);
+            VCPWriteDebug4("Sync overruns TIM/RX/TX:", syncTimerOverruns, syncRxOverruns, syncTxOverruns);
+        }
+        log_info("Ring high water marks: [VCP RX: %u/%u, VCP TX: %u/%u, Serial TX: %u/%u]",
+            vcpRxFifo.highWater, vcpRxFifo.size, vcpTxFifo.highWater, vcpTxFifo.size, serialTxFifo.highWater, serialTxFifo.size);
+        for (uint8_t i = 0; i < HDLC_LAT_TYPES; i++)
+        {
+            HdlcLatency_t *lat = &hdlcLatency[i];
+            log_info("%s latency (ms): [Last: %lu, Max: %lu, Avg: %lu, Count: %lu]", i == HDLC_LAT_UA ? "SABM->UA" : "XID->XID",
+                lat->last, lat->max, lat->count ? lat->sum / lat->count : 0UL, lat->count);
+        }
+        #ifdef TX_JITTER
+        log_info("TX jitter buffer: [Target: %u, Played: %lu, Late: %lu, Early: %lu, Underruns: %lu]", jitterTarget, jitterPlayed, jitterLate, jitterEarly, jitterUnderruns);
+        #endif
+        log_info("TX queue drops: [TSBK: %lu, Data: %lu]", txqDrops[TXQ_TSBK], txqDrops[TXQ_DATA]);
+        #ifdef ISR_CYCLE_STATS
+        // TIM2 updates twice per bit, and runs from the same 72 MHz as the core
+        uint32_t rate = SyncGetLineRate();
+        IsrCyclesLog(rate ? SystemCoreClock / (rate * 2U) : 0U);
+        #endif
+        #ifdef SYNC_RX_OVERSAMPLE
+        log_info("RX DPLL: [Transitions: %lu, Ahead: %lu, Behind: %lu, Error sum: %lu]", syncDpllTransitions, syncDpllAhead, syncDpllBehind, syncDpllErrSum);
+        #endif
     }
     #endif
 }
 
 void hdlcFrameSpace()
 {
-    for (int i=0; i<FRAME_SPACING; i++)
-    {
-        SyncAddTxByte(HDLC_SYNC_WORD);
-    }
+    // The closing flag is added along with the frame itself
+    SyncAddTxFlags(FRAME_SPACING - 1);
 }
 
 /**
- * @brief Encodes, escapes, and sends an HDLC frame
+ * @brief Queues an HDLC frame for FCS, bit stuffing & TX, all done in a single pass into the TX ring
  * 
- * outputData length should be +2 from input data to allow for trailing FCS
+ * This takes ownership of the buffer, which is freed once the frame is in the TX ring
  * 
- * @param outputData output buffer to store encoded frame in
- * @param inputData input data array to encode
- * @param inputLength length of input data array
+ * @param buf TX buffer holding the frame from the address byte on
 */
-void hdlcEncodeAndSendFrame(const uint8_t *data, const uint8_t len)
+void hdlcSendBuf(TxBuf_t *buf)
 {
-    // Calculate FCS of message
-    uint16_t fcs = crc16(data, len);
-    // Append
-    uint8_t frame[HDLC_MAX_FRAME_SIZE_BYTES];
-    memcpy(&frame, data, len);
-    frame[len] = low(fcs);
-    frame[len + 1] = high(fcs);
     // Trace
     #ifdef TRACE_HDLC
     uint8_t hexStrBuf[HDLC_MAX_FRAME_SIZE_BYTES * 4];
-    HexArrayToStr((char*)hexStrBuf, frame, len + 2);
-    log_trace("Encoded HDLC: %s", hexStrBuf);
+    HexArrayToStr((char*)hexStrBuf, TxBufData(buf), buf->len);
+    log_trace("Encoded HDLC (without FCS): %s", hexStrBuf);
     #endif
-    // See if we need to escape anything
-    uint8_t escapes = HDLCGetEscapesReq(frame, len + 2);
-    if (escapes)
+    // Bit stuff the message, its FCS and a trailing 7E straight into the TX ring
+    if (SyncAddTxFrame(TxBufData(buf), buf->len))
     {
-        uint8_t escFrame[HDLC_MAX_FRAME_SIZE_BYTES];
-        if (HDLCEscape(escFrame, frame, len + 2) != escapes)
-        {
-            log_error("Didn't escape the bytes we expected!");
-        }
-        else
-        {
-            // Add the message and a trailing 7E
-            if (SyncAddTxBytes(escFrame, len + 2 + escapes))
-            {
-                txTotalFrames++;
-                hdlcFrameSpace();
-            }
-        }
+        hdlcFrameSpace();
+        txTotalFrames++;
     }
-    else
+    TxBufFree(buf);
+    // Update timer
+    hdlcLastTx = HAL_GetTick();
+}
+
+/**
+ * @brief Sends a short link control frame
+ * 
+ * With HDLC_CTRL_FAST_LANE this goes in the sync control ring, which goes out at the next frame boundary instead of
+ * waiting behind the UI frames already queued
+ * 
+ * @param data frame from the address byte on
+ * @param len length of the frame
+ * @return true if it was queued
+*/
+bool hdlcSendCtrl(const uint8_t *data, const uint16_t len)
+{
+    #ifdef HDLC_CTRL_FAST_LANE
+    // The closing flag is added along with the frame itself
+    if (!SyncAddTxCtrlFrame(data, len, FRAME_SPACING - 1))
     {
-        // Add the message and a trailing 7E
-        if (SyncAddTxBytes(frame, len + 2))
-        {
-            hdlcFrameSpace();
-            txTotalFrames ++;
-        }
-        
+        return false;
     }
+    #else
+    if (!SyncAddTxFrame(data, len))
+    {
+        return false;
+    }
+    hdlcFrameSpace();
+    #endif
+    txTotalFrames++;
     // Update timer
     hdlcLastTx = HAL_GetTick();
+    return true;
 }
 
 /**
@@ -184,174 +246,90 @@ void hdlcEncodeAndSendFrame(const uint8_t *data, const uint8_t len)
 void HDLCSendSABM(uint8_t address)
 {
     const uint8_t data[2] = { address, HDLC_CTRL_SABM };
-    hdlcEncodeAndSendFrame(data, 2);
+    hdlcSendCtrl(data, 2);
     log_info("Sent SABM frame");
 }
 
-void HDLCSendUA(uint8_t address)
+bool HDLCSendUA(uint8_t address)
 {
     const uint8_t data[2] = { address, HDLC_CTRL_UA };
-    hdlcEncodeAndSendFrame(data, 2);
+    bool sent = hdlcSendCtrl(data, 2);
     log_info("Sent UA frame");
+    return sent;
 }
 
-void HDLCSendXID(uint8_t address, uint8_t msg_type, uint8_t site, uint8_t station_type)
+bool HDLCSendXID(uint8_t address, uint8_t msg_type, uint8_t site, uint8_t station_type)
 {
     const uint8_t data[10] = { address, HDLC_CTRL_XID, msg_type, (site * 2) + 1, station_type, 0, 0, 0, 0, 0xFF };
-    hdlcEncodeAndSendFrame(data, 10);
+    bool sent = hdlcSendCtrl(data, 10);
     log_info("Sent XID frame");
+    return sent;
 }
 
 void HDLCSendRR()
 {
     const uint8_t data[2] = { HDLC_ADDRESS, 0x01 };
-    hdlcEncodeAndSendFrame(data, 2);
+    hdlcSendCtrl(data, 2);
     log_info("Sent RR frame");
 }
 
-void HDLCSendUI(uint8_t *msgData, uint8_t len)
-{
-    // We need 2 extra bytes for address and control
-    uint8_t data[HDLC_MAX_FRAME_SIZE_BYTES];
-    data[0] = peerAddress;
-    data[1] = HDLC_CTRL_UI;
-    memcpy(&data[2], msgData, len);
-    // Encode frame
-    hdlcEncodeAndSendFrame(data, len + 2);
-    log_info("Sent UI frame (len: %d)", len);
-}
-
 /**
- * @brief Checks an HDLC message for correct FCS
+ * @brief Send a UI frame whose payload is already in a TX buffer, the address & control go in its head room
  * 
- * @param msg pointer to HDLC message
- * @param len length of HDLC message
- * 
- * @return true on good FCS, false if not
+ * @param buf TX buffer holding the payload (ownership passes to the HDLC layer)
 */
-bool HDLCCheckFCS(uint8_t *msg, uint8_t len)
+void HDLCSendUIBuf(TxBuf_t *buf)
 {
-    // Get received FCS from last two bytes of message
-    uint16_t msg_fcs = (msg[len-1]<<8) | msg[len-2];
-    // Calculate FCS for all bytes except the last two
-    uint16_t calc_fcs = crc16(msg, len-2);
-    // Return
-    if (msg_fcs != calc_fcs)
-    {
-        log_error("Expected FCS %04X, Got FCS %04X", calc_fcs, msg_fcs);
-        return false;
-    }
-    else
-    {
-        return true;
-    }
-}
-
-/**
- * @brief counts the number of 0x7E or 0x7D bytes in a message, for escaping purposes
- * 
- * @param *msg input message
- * @param len input message length
- * 
- * @returns the number of 0x7E and 0x7D bytes
-*/
-uint8_t HDLCGetEscapesReq(uint8_t *msg, uint8_t len)
-{
-    // Count the number of 7E and 7D bytes in the original message
-    uint8_t numEscapes = 0;
-    for (int i=0; i<len; i++)
-    {
-        if (msg[i] == 0x7E || msg[i] == 0x7D)
-        {
-            numEscapes++;
-        }
-    }
-    return numEscapes;
+    uint16_t len = buf->len;
+    uint8_t *hdr = TxBufPrepend(buf, 2);
+    hdr[0] = peerAddress;
+    hdr[1] = HDLC_CTRL_UI;
+    hdlcSendBuf(buf);
+    log_info("Sent UI frame (len: %d)", len);
 }
 
 /**
- * @brief Parse any values that need escaping (0x7E or 0x7D) and escape them
+ * @brief Get the largest UI frame payload that can be queued for TX right now
  * 
- * @param *out output buffer to write the unescaped data to (must be big enough!)
- * @param *msg input data to escape
- * @param len input data length
+ * This allows for worst case bit stuffing. Without HDLC_CTRL_FAST_LANE it also leaves HDLC_TX_CTRL_RESERVE_BITS
+ * free for link control frames, which otherwise have a ring of their own.
  * 
- * @returns the number of escape sequences
+ * @return payload length in bytes
 */
-uint8_t HDLCEscape(uint8_t *out, uint8_t *msg, uint8_t len)
+uint16_t HDLCGetUIRoom()
 {
-    uint8_t numEscapes = 0;
-    for (int i=0; i<len; i++)
-    {
-        if (msg[i] == 0x7E)
-        {
-            out[i+numEscapes] = 0x7D;
-            out[i+numEscapes+1] = 0x5E;
-            numEscapes++;
-        }
-        else if (msg[i] == 0x7D)
-        {
-            out[i+numEscapes] = 0x7D;
-            out[i+numEscapes+1] = 0x5D;
-            numEscapes++;
-        }
-        else
-        {
-            out[i+numEscapes] = msg[i];
-        }
-    }
-    return numEscapes;
+    // Address, control & FCS around the payload, then the closing & spacing flags
+    #ifdef HDLC_CTRL_FAST_LANE
+    const uint16_t overhead = 4U * 10U + FRAME_SPACING * 8U;
+    #else
+    const uint16_t overhead = HDLC_TX_CTRL_RESERVE_BITS + 4U * 10U + FRAME_SPACING * 8U;
+    #endif
+    uint16_t bits = SyncGetTxFreeBits();
+    return bits > overhead ? (bits - overhead) / 10U : 0U;
 }
 
-/**
- * @brief Parse any escape sequences back to their original values
- * 
- * @param *out output buffer to write the unescaped data to
- * @param *msg input data to escape
- * @param len length of input data
- * 
- * @returns the number of escape sequences
-*/
-uint8_t HDLCUnescape(uint8_t *out, uint8_t *msg, uint8_t len)
+void HDLCSendUI(uint8_t *msgData, uint16_t len)
 {
-    uint8_t lastByte = 0;
-    uint8_t numEscapes = 0;
-    for (int i=0; i<len; i++)
+    TxBuf_t *buf = TxBufAlloc();
+    if (buf == NULL)
     {
-        if (lastByte == HDLC_ESCAPE_CODE && msg[i] == HDLC_ESCAPE_7E)
-        {
-        	numEscapes++;
-            out[i-numEscapes] = 0x7E;
-            #ifdef TRACE_HDLC
-            log_trace("Replaced 7D 5E with 7E");
-            #endif
-        }
-        else if (lastByte == HDLC_ESCAPE_CODE && msg[i] == HDLC_ESCAPE_7D)
-        {
-        	numEscapes++;
-        	out[i-numEscapes] = 0x7D;
-            #ifdef TRACE_HDLC
-            log_trace("Replaced 7D 5D with 7D");
-            #endif
-        }
-        else
-        {
-            out[i-numEscapes] = msg[i];
-            #ifdef TRACE_HDLC
-            log_trace("msg[%d] (%02X) -> out[%d] (%02X)", i, msg[i], i-numEscapes, out[i-numEscapes]);
-            #endif
-        }
-        lastByte = msg[i];
+        return;
     }
-    return numEscapes;
+    memcpy(TxBufAppend(buf, len), msgData, len);
+    HDLCSendUIBuf(buf);
 }
 
 /**
  * @brief Processes a full HDLC message (exclusing sync words)
  * 
+ * @param msg destuffed frame, including the FCS
+ * @param len length of the frame
+ * @param fcsOk whether the FCS was good (checked as the frame was received)
+ * @param rxTick HAL tick the frame's closing flag came in, for timing our replies
+ * 
  * @returns 1 on error, 0 on success
 */
-uint8_t HDLCParseMsg(uint8_t* rawMsg, uint8_t rawLen)
+uint8_t HDLCParseMsg(uint8_t* msg, uint16_t len, bool fcsOk, uint32_t rxTick)
 {
     // Debug print hex buffer
     #ifdef TRACE_HDLC
@@ -362,41 +340,24 @@ uint8_t HDLCParseMsg(uint8_t* rawMsg, uint8_t rawLen)
     rxTotalFrames++;
     // Log print
     #ifdef TRACE_HDLC
-    printHexArray((char*)hexStrBuf, rawMsg, rawLen);
-    log_trace("Processing %d-byte HDLC message:%s", rawLen, hexStrBuf);
+    printHexArray((char*)hexStrBuf, msg, len);
+    log_trace("Processing %d-byte HDLC message:%s", len, hexStrBuf);
     #endif
-    // Escape
-    uint8_t msg[HDLC_MAX_FRAME_SIZE_BYTES];
-    uint8_t len = rawLen - HDLCUnescape(msg, rawMsg, rawLen);
-    #ifdef TRACE_HDLC
-    if (len != rawLen)
+    // The FCS was run over the frame as it came in
+    if (!fcsOk)
     {
-        printHexArray((char*)hexStrBuf, msg, len);
-        log_trace("Escaped %d bytes to new %d-byte message:%s", rawLen - len, len, hexStrBuf);
+        log_error("FCS check failed!");
+        return 1;
     }
-    #endif
     // Get parameters
     uint8_t msg_addr = msg[0];
     uint8_t msg_ctrl = msg[1];
     // Data is bytes 2 to len-2 so buffer size is 4 less
-    uint8_t data_len = len - 4;
-    /*uint8_t msg_data[HDLC_MAX_FRAME_SIZE_BYTES];
-    memset(msg_data, 0, data_len);
-    memcpy(msg_data, &msg[2], (data_len) * sizeof(uint8_t));*/
+    uint16_t data_len = len - 4;
     #ifdef TRACE_HDLC
     printHexArray((char*)hexStrBuf, msg + 2U, data_len);
     log_trace("Msg data:%s", hexStrBuf);
     #endif
-    // Calculate expected FCS by getting the entire message minus the FCS
-    if (!HDLCCheckFCS(msg, len))
-    {
-        log_error("FCS check failed!");
-        #ifdef TRACE_HDLC
-        printHexArray((char*)hexStrBuf, msg, len);
-        log_trace("Message:%s", hexStrBuf);
-        #endif
-        return 1;
-    }
     // Increment valid frames counter
     rxValidFrames++;
     // Update the peer address if needed
@@ -411,13 +372,19 @@ uint8_t HDLCParseMsg(uint8_t* rawMsg, uint8_t rawLen)
         case HDLC_CTRL_SABM:
             log_info("Got SABM frame");
             hdlcLastRx = HAL_GetTick();
-            HDLCSendUA(peerAddress);
+            if (HDLCSendUA(peerAddress))
+            {
+                hdlcLatencyStart(&hdlcLatency[HDLC_LAT_UA], rxTick);
+            }
             break;
         // We respond to an XID by storing the data and sending our own
         case HDLC_CTRL_XID:
             log_info("Got XID frame");
             hdlcLastRx = HAL_GetTick();
-            HDLCSendXID(HDLC_ADDRESS, HDLC_CTRL_XID, HDLC_SITE, 0x00);
+            if (HDLCSendXID(HDLC_ADDRESS, HDLC_CTRL_XID, HDLC_SITE, 0x00))
+            {
+                hdlcLatencyStart(&hdlcLatency[HDLC_LAT_XID], rxTick);
+            }
             break;
         case HDLC_CTRL_RR:
             log_info("Got RR frame");
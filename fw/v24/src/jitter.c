@@ -0,0 +1,303 @@
+/**
+  ******************************************************************************
+  * @file           : jitter.c
+  * @brief          : TX jitter buffer, plays voice frames out to the V24 peer
+  *                   on the 20 ms IMBE cadence
+  *
+  * The host sends P25 frames in bursts, but the Quantar expects a voice frame
+  * every 20 ms. Voice stream frames from the host are copied into a ring here
+  * (see txq.c), and the main loop hands them to the HDLC layer in order. Voice
+  * frames wait until the target depth has built up and then go out one per
+  * JITTER_FRAME_MS, the start/end and header records go out as soon as they
+  * reach the front. If the buffer runs dry in
+  * the middle of a stream the line just idles in flags until it has built up
+  * again, and the target goes up by a frame (up to the maximum depth). Voice
+  * frames that arrive with the buffer already at the maximum depth are
+  * dropped, which bounds the added latency. Only used from the main loop.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "jitter.h"
+
+#include "hdlc.h"
+#include "log.h"
+#include "ring.h"
+#include "string.h"
+#include "txq.h"
+
+#ifdef TX_JITTER
+
+_Static_assert((JITTER_BUF_LEN & (JITTER_BUF_LEN - 1)) == 0, "JITTER_BUF_LEN must be a power of 2");
+// A frame of the largest size has to fit, with its length
+_Static_assert(JITTER_BUF_LEN >= TXBUF_SIZE + 2U, "JITTER_BUF_LEN too small for TXBUF_SIZE");
+_Static_assert(TX_JITTER_TARGET >= 1U && TX_JITTER_TARGET <= TX_JITTER_MAX, "TX_JITTER_TARGET must be 1 to TX_JITTER_MAX");
+
+// Playout state
+enum JitterState {
+    JIT_IDLE = 0x00,    // no voice stream
+    JIT_FILL = 0x01,    // building up to the target depth before playing
+    JIT_PLAY = 0x02,    // playing voice frames out on the cadence
+};
+
+// Buffered frames, each a 16 bit big-endian payload length followed by the payload
+uint8_t jitterBuf[JITTER_BUF_LEN];
+Ring_t jitterFifo = RING_INIT(jitterBuf);
+
+enum JitterState jitterState = JIT_IDLE;
+// Number of frames in the ring, and how many of them are voice
+uint8_t jitterFrames = 0;
+uint8_t jitterVoice = 0;
+// Configured target & maximum depth in voice frames, and the target in use right now
+uint8_t jitterCfgTarget = TX_JITTER_TARGET;
+uint8_t jitterCfgMax = TX_JITTER_MAX;
+uint8_t jitterTarget = TX_JITTER_TARGET;
+// When we started filling, and when the next voice frame is due out
+uint32_t jitterFillStart = 0;
+uint32_t jitterNextDue = 0;
+// Arrival of the last voice frame, for telling the end of a stream from a late frame
+uint32_t jitterLastVoice = 0;
+// Set when a voice frame was due but there wasn't one, and when that was
+bool jitterGap = false;
+uint32_t jitterGapStart = 0;
+// Voice frames played since the last late one
+uint16_t jitterSteady = 0;
+
+// Statistics: voice frames played out, voice frames that arrived after their slot, voice frames dropped for arriving
+// with the buffer full, and voice slots the line idled through mid-stream
+uint32_t jitterPlayed = 0;
+uint32_t jitterLate = 0;
+uint32_t jitterEarly = 0;
+uint32_t jitterUnderruns = 0;
+
+/**
+ * @brief Check if a frame is voice, from its first payload byte
+*/
+static inline bool jitterIsVoice(uint8_t type)
+{
+    return TxqClassify(type) == TXQ_VOICE;
+}
+
+/**
+ * @brief Drop everything buffered and go back to idle (the statistics are kept)
+*/
+void JitterReset()
+{
+    RingClear(&jitterFifo);
+    jitterFrames = 0;
+    jitterVoice = 0;
+    jitterState = JIT_IDLE;
+    jitterTarget = jitterCfgTarget;
+    jitterGap = false;
+    jitterSteady = 0;
+}
+
+/**
+ * @brief Buffer a frame for playout
+ *
+ * The frame is copied into the jitter ring and the TX buffer freed. Voice frames that would take the buffer past
+ * the maximum depth are dropped (and freed).
+ *
+ * @param buf TX buffer holding the UI payload
+ * @return true if the buffer was taken, false if the ring is out of room (the caller keeps the buffer)
+*/
+bool JitterPut(TxBuf_t *buf)
+{
+    if (RingFree(&jitterFifo) < buf->len + 2U || jitterFrames == 0xFFU)
+    {
+        return false;
+    }
+    uint32_t now = HAL_GetTick();
+    bool voice = jitterIsVoice(TxBufData(buf)[0]);
+    if (voice)
+    {
+        if (jitterVoice >= jitterCfgMax)
+        {
+            jitterEarly++;
+            TxBufFree(buf);
+            return true;
+        }
+        // The playout ran dry before this one arrived, so it's late unless the gap was long enough to be a new stream
+        if (jitterGap)
+        {
+            jitterGap = false;
+            if (now - jitterLastVoice <= JITTER_STREAM_TIMEOUT)
+            {
+                jitterLate++;
+                jitterUnderruns += (now - jitterGapStart) / JITTER_FRAME_MS + 1U;
+                jitterSteady = 0;
+                if (jitterTarget < jitterCfgMax)
+                {
+                    jitterTarget++;
+                    log_warn("TX jitter buffer underrun, target depth now %u", jitterTarget);
+                }
+            }
+        }
+        if (jitterState == JIT_IDLE)
+        {
+            jitterState = JIT_FILL;
+            jitterFillStart = now;
+        }
+        jitterLastVoice = now;
+        jitterVoice++;
+    }
+    const uint8_t hdr[2] = { (buf->len >> 8) & 0xFFU, buf->len & 0xFFU };
+    RingWrite(&jitterFifo, hdr, 2U);
+    RingWrite(&jitterFifo, TxBufData(buf), buf->len);
+    jitterFrames++;
+    TxBufFree(buf);
+    return true;
+}
+
+/**
+ * @brief Send the frame at the front of the ring as a UI frame, if the sync TX ring has room for it
+ * @param len payload length
+ * @return true if it was sent
+*/
+static bool jitterSend(uint16_t len)
+{
+    if (len > HDLCGetUIRoom())
+    {
+        return false;
+    }
+    TxBuf_t *buf = TxBufAlloc();
+    if (buf == NULL)
+    {
+        return false;
+    }
+    RingReadCommit(&jitterFifo, 2U);
+    RingRead(&jitterFifo, TxBufAppend(buf, len), len);
+    jitterFrames--;
+    HDLCSendUIBuf(buf);
+    return true;
+}
+
+/**
+ * @brief Called during the main loop to play frames out to the HDLC layer
+*/
+void JitterCallback()
+{
+    uint32_t now = HAL_GetTick();
+
+    // Start playing once the target depth has built up. If it doesn't within the time it should have taken, or the
+    // stream has already ended (something other than voice is queued behind it), waiting longer only adds delay
+    if (jitterState == JIT_FILL &&
+        (jitterVoice >= jitterTarget || jitterFrames > jitterVoice || now - jitterFillStart >= jitterTarget * JITTER_FRAME_MS))
+    {
+        jitterState = JIT_PLAY;
+        jitterNextDue = now;
+    }
+
+    while (jitterFrames > 0)
+    {
+        uint8_t hi, lo, type;
+        RingPeek(&jitterFifo, 0U, &hi);
+        RingPeek(&jitterFifo, 1U, &lo);
+        RingPeek(&jitterFifo, 2U, &type);
+        uint16_t len = ((uint16_t)hi << 8) | lo;
+        // Start/end & header records go straight out, in order
+        if (!jitterIsVoice(type))
+        {
+            if (!jitterSend(len))
+            {
+                return;
+            }
+            continue;
+        }
+        // Voice waits for its slot
+        if (jitterState != JIT_PLAY || (int32_t)(now - jitterNextDue) < 0 || !jitterSend(len))
+        {
+            return;
+        }
+        jitterVoice--;
+        jitterPlayed++;
+        // Slots are kept on a fixed 20 ms grid, unless we've fallen behind it (waiting on sync TX room), in which
+        // case the grid restarts from now rather than catching up with a burst
+        jitterNextDue += JITTER_FRAME_MS;
+        if ((int32_t)(now - jitterNextDue) >= 0)
+        {
+            jitterNextDue = now + JITTER_FRAME_MS;
+        }
+        // Ease the target back down once the stream has been steady for a while
+        if (++jitterSteady >= JITTER_ADAPT_FRAMES)
+        {
+            jitterSteady = 0;
+            if (jitterTarget > jitterCfgTarget)
+            {
+                jitterTarget--;
+            }
+        }
+    }
+
+    // Nothing to play in a voice slot, the line idles in flags and we build back up to the target. Whether that was
+    // an underrun or just the end of the stream is worked out when (or if) the next voice frame turns up
+    if (jitterState == JIT_PLAY && (int32_t)(now - jitterNextDue) >= 0)
+    {
+        jitterState = JIT_IDLE;
+        jitterGap = true;
+        jitterGapStart = now;
+    }
+}
+
+/**
+ * @brief Change the target & maximum depth
+ * @param target voice frames to build up before playing
+ * @param max voice frames to buffer at most
+ * @return false if the depths are out of range
+*/
+bool JitterSetDepth(uint8_t target, uint8_t max)
+{
+    if (target < 1U || target > max)
+    {
+        return false;
+    }
+    jitterCfgTarget = target;
+    jitterCfgMax = max;
+    jitterTarget = target;
+    jitterSteady = 0;
+    log_info("TX jitter buffer target depth %u, max %u", target, max);
+    return true;
+}
+
+/**
+ * @brief Get the configured target & maximum depth
+*/
+void JitterGetDepth(uint8_t *target, uint8_t *max)
+{
+    *target = jitterCfgTarget;
+    *max = jitterCfgMax;
+}
+
+/**
+ * @brief Get the number of voice frames waiting to be played
+*/
+uint8_t JitterGetVoice()
+{
+    return jitterVoice;
+}
+
+/**
+ * @brief Get the number of frames waiting, voice and the stream records around it
+*/
+uint8_t JitterGetFrames()
+{
+    return jitterFrames;
+}
+
+/**
+ * @brief Check if a voice stream is being buffered or played
+*/
+bool JitterActive()
+{
+    return jitterState != JIT_IDLE || jitterVoice > 0;
+}
+
+/**
+ * @brief Get the number of bytes buffered, for the host credit
+*/
+uint16_t JitterGetUsed()
+{
+    return RingUsed(&jitterFifo);
+}
+
+#endif
@@ -0,0 +1,247 @@
+/**
+  ******************************************************************************
+  * @file           : ring.c
+  * @brief          : Lock-free single producer, single consumer byte ring
+  *
+  * Replaces the old FIFO, which kept a size count that both sides updated and
+  * could be corrupted when one of them was an interrupt. Here each index has a
+  * single writer, and a barrier sits between touching the buffer and
+  * publishing the index, so the other side never sees an index move before
+  * the bytes behind it. Bulk reads & writes are two memcpys at most, and the
+  * span calls let a DMA transfer or memcpy work straight on the buffer.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "ring.h"
+
+#include <string.h>
+
+/**
+ * @brief Publish newly written bytes to the consumer (producer side)
+ * @param *r ring
+ * @param head new head index
+*/
+static inline void ringPublish(Ring_t *r, uint16_t head)
+{
+    // Buffer writes have to land before the consumer can see the new head
+    RING_BARRIER();
+    r->head = head;
+    uint16_t used = (uint16_t)(head - r->tail);
+    if (used > r->highWater)
+    {
+        r->highWater = used;
+    }
+}
+
+/**
+ * @brief Release read bytes back to the producer (consumer side)
+ * @param *r ring
+ * @param tail new tail index
+*/
+static inline void ringRelease(Ring_t *r, uint16_t tail)
+{
+    // Buffer reads have to be done before the producer can reuse the space
+    RING_BARRIER();
+    r->tail = tail;
+}
+
+/**
+ * @brief Push a single byte into the ring
+ * @param *r ring
+ * @param data byte to push
+ * @return true on success, false if the ring is full
+*/
+bool RingPush(Ring_t *r, uint8_t data)
+{
+    uint16_t head = r->head;
+    if ((uint16_t)(head - r->tail) >= r->size)
+    {
+        return false;
+    }
+    r->buffer[head & (r->size - 1)] = data;
+    ringPublish(r, head + 1);
+    return true;
+}
+
+/**
+ * @brief Write a block of bytes into the ring, all or nothing
+ * @param *r ring
+ * @param *data bytes to write
+ * @param len number of bytes
+ * @return true on success, false (and nothing written) if there isn't room for all of them
+*/
+bool RingWrite(Ring_t *r, const uint8_t *data, uint16_t len)
+{
+    uint16_t head = r->head;
+    if ((uint32_t)(uint16_t)(head - r->tail) + len > r->size)
+    {
+        return false;
+    }
+    uint16_t pos = head & (r->size - 1);
+    uint16_t first = r->size - pos;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&r->buffer[pos], data, first);
+    memcpy(r->buffer, data + first, len - first);
+    ringPublish(r, head + len);
+    return true;
+}
+
+/**
+ * @brief Get the contiguous free space at the write position, for writing in place
+ *
+ * Write up to the returned number of bytes to *span, then publish them with RingWriteCommit
+ *
+ * @param *r ring
+ * @param **span set to the first free byte
+ * @return number of bytes that can be written at *span
+*/
+uint16_t RingWriteSpan(Ring_t *r, uint8_t **span)
+{
+    uint16_t head = r->head;
+    uint16_t pos = head & (r->size - 1);
+    uint16_t free = r->size - (uint16_t)(head - r->tail);
+    uint16_t toEnd = r->size - pos;
+    *span = &r->buffer[pos];
+    return free < toEnd ? free : toEnd;
+}
+
+/**
+ * @brief Publish bytes written in place after RingWriteSpan
+ * @param *r ring
+ * @param len number of bytes written (no more than RingWriteSpan returned)
+*/
+void RingWriteCommit(Ring_t *r, uint16_t len)
+{
+    ringPublish(r, r->head + len);
+}
+
+/**
+ * @brief Pop a single byte from the ring
+ * @param *r ring
+ * @param *data where to store the popped byte
+ * @return true on success, false if the ring is empty
+*/
+bool RingPop(Ring_t *r, uint8_t *data)
+{
+    uint16_t tail = r->tail;
+    if (tail == r->head)
+    {
+        return false;
+    }
+    // Don't read the byte until we've seen the head that covers it
+    RING_BARRIER();
+    *data = r->buffer[tail & (r->size - 1)];
+    ringRelease(r, tail + 1);
+    return true;
+}
+
+/**
+ * @brief Look at a byte without reading it
+ * @param *r ring
+ * @param offset how far past the read position to look
+ * @param *data where to store the byte
+ * @return true on success, false if the ring doesn't hold that many bytes
+*/
+bool RingPeek(const Ring_t *r, uint16_t offset, uint8_t *data)
+{
+    uint16_t tail = r->tail;
+    if ((uint16_t)(r->head - tail) <= offset)
+    {
+        return false;
+    }
+    RING_BARRIER();
+    *data = r->buffer[(uint16_t)(tail + offset) & (r->size - 1)];
+    return true;
+}
+
+/**
+ * @brief Read up to a block of bytes from the ring
+ * @param *r ring
+ * @param *data where to store the bytes
+ * @param len most bytes to read
+ * @return number of bytes read
+*/
+uint16_t RingRead(Ring_t *r, uint8_t *data, uint16_t len)
+{
+    uint16_t tail = r->tail;
+    uint16_t used = (uint16_t)(r->head - tail);
+    if (len > used)
+    {
+        len = used;
+    }
+    if (len == 0)
+    {
+        return 0;
+    }
+    RING_BARRIER();
+    uint16_t pos = tail & (r->size - 1);
+    uint16_t first = r->size - pos;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(data, &r->buffer[pos], first);
+    memcpy(data + first, r->buffer, len - first);
+    ringRelease(r, tail + len);
+    return len;
+}
+
+/**
+ * @brief Get the contiguous readable bytes at the read position, for reading in place (e.g. by DMA)
+ *
+ * The bytes stay valid until they're released with RingReadCommit
+ *
+ * @param *r ring
+ * @param **span set to the first readable byte
+ * @return number of bytes that can be read at *span
+*/
+uint16_t RingReadSpan(Ring_t *r, uint8_t **span)
+{
+    uint16_t tail = r->tail;
+    uint16_t used = (uint16_t)(r->head - tail);
+    uint16_t pos = tail & (r->size - 1);
+    uint16_t toEnd = r->size - pos;
+    RING_BARRIER();
+    *span = &r->buffer[pos];
+    return used < toEnd ? used : toEnd;
+}
+
+/**
+ * @brief Release bytes read in place after RingReadSpan
+ * @param *r ring
+ * @param len number of bytes read (no more than RingReadSpan returned)
+*/
+void RingReadCommit(Ring_t *r, uint16_t len)
+{
+    ringRelease(r, r->tail + len);
+}
+
+/**
+ * @brief Discard everything in the ring
+ *
+ * This moves the tail, so it's a consumer side call (or for when both sides run in the same context)
+ *
+ * @param *r ring
+*/
+void RingClear(Ring_t *r)
+{
+    ringRelease(r, r->head);
+}
+
+/**
+ * @brief Empty the ring and move both indexes back to the start of the buffer
+ *
+ * Only for when neither side is running, e.g. before (re)starting a DMA transfer that produces into the ring
+ *
+ * @param *r ring
+*/
+void RingReset(Ring_t *r)
+{
+    r->head = 0;
+    r->tail = 0;
+    RING_BARRIER();
+}
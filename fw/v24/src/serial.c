@@ -8,37 +8,38 @@
 // self-referential include
 #include "serial.h"
 
-#include "fifo.h"
+#include "ring.h"
 #include "stdbool.h"
 #include "config.h"
 #include "util.h"
 #include "leds.h"
 #include "vcp.h"
 
-uint8_t serialDMABuffer[SERIAL_BUFFER_SIZE];
-
-// Serial TX Fifo Buffer
+// Serial TX ring, DMA sends straight out of it
+_Static_assert((SERIAL_BUFFER_SIZE & (SERIAL_BUFFER_SIZE - 1)) == 0, "SERIAL_BUFFER_SIZE must be a power of 2");
 uint8_t serialTxBuf[SERIAL_BUFFER_SIZE];
-FIFO_t serialTxFifo = {
-    .buffer = serialTxBuf,
-    .head = 0,
-    .tail = 0,
-    .maxlen = SERIAL_BUFFER_SIZE
-};
+Ring_t serialTxFifo = RING_INIT(serialTxBuf);
+
+// Number of bytes the running DMA transfer is sending from the ring
+uint16_t serialDMABytes = 0;
 
 volatile bool serialTxSending = false;
 
 /**
- * @brief fills the IT buffer with the next N bytes from the FIFO
+ * @brief Start a DMA transfer of the next contiguous run of bytes in the ring
  * 
- * @returns the number of bytes pulled from the FIFO
+ * @param *huart UART to send on
+ * @returns the number of bytes being sent
 */
-uint16_t SerialFillDMA()
+uint16_t serialStartDMA(UART_HandleTypeDef *huart)
 {
-    // Get the next batch of bytes from the FIFO
-    uint16_t bytes = 0;
-    while (!FifoPop(&serialTxFifo, &serialDMABuffer[bytes]) && bytes < SERIAL_BUFFER_SIZE) { bytes++; }
-    return bytes;
+    uint8_t *span;
+    serialDMABytes = RingReadSpan(&serialTxFifo, &span);
+    if (serialDMABytes > 0)
+    {
+        HAL_UART_Transmit_DMA(huart, span, serialDMABytes);
+    }
+    return serialDMABytes;
 }
 
 /**
@@ -49,11 +50,10 @@ void SerialCallback(UART_HandleTypeDef *huart)
     // Only start if we're not already running
     if (!serialTxSending)
     {
-        uint16_t bytes = SerialFillDMA();
-        if (bytes > 0)
+        serialTxSending = true;
+        if (serialStartDMA(huart) == 0)
         {
-            serialTxSending = true;
-            HAL_UART_Transmit_DMA(huart, serialDMABuffer, bytes);
+            serialTxSending = false;
         }
     }
 }
@@ -65,12 +65,9 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
     if (huart->Instance == USART2)
     {
-        uint16_t bytes = SerialFillDMA();
-        if (bytes > 0)
-        {
-            HAL_UART_Transmit_DMA(huart, serialDMABuffer, bytes);
-        }
-        else
+        // The bytes just sent can be reused now
+        RingReadCommit(&serialTxFifo, serialDMABytes);
+        if (serialStartDMA(huart) == 0)
         {
             serialTxSending = false;
         }
@@ -89,13 +86,8 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
  *  @retval none
  */
 void SerialWrite(const char *data) {
-    uint16_t len = strlen(data);
-    for (int i=0; i<len; i++)
-    {
-        if (FifoPush(&serialTxFifo, data[i]) == -1) {
-            FifoClear(&serialTxFifo);
-        }
-    }
+    // Anything that doesn't fit is dropped whole, rather than leaving half a line in the output
+    RingWrite(&serialTxFifo, (const uint8_t *)data, strlen(data));
 }
 
 /**
@@ -11,12 +11,15 @@
 // Libs
 #include "leds.h"
 #include "stdio.h"
-#include "fifo.h"
 #include "log.h"
 #include "util.h"
 #include "config.h"
 #include "hdlc.h"
 #include "vcp.h"
+#include "bitstuff.h"
+#include "crc.h"
+#include "tim.h"
+#include "txq.h"
 
 bool falling = true;
 bool txd = false;
@@ -26,30 +29,52 @@ extern unsigned long rxTotalFrames;
 extern unsigned long rxValidFrames;
 extern unsigned long txTotalFrames;
 
-// TX fifo buffer
-uint8_t syncTxBuf[SYNC_TX_BUF_LEN];
-FIFO_t syncTxFifo = {
-    .buffer = syncTxBuf,
-    .head = 0,
-    .tail = 0,
-    .maxlen = SYNC_TX_BUF_LEN
-};
-// Current byte to transmit
-uint8_t syncTxByte = 0;
-volatile uint8_t syncTxBytePos = 0;
-volatile uint8_t syncLastTxByte = 0;
-volatile bool syncTxFlag = false;
-
-// RX fifo buffer
-uint8_t syncRxBuf[SYNC_RX_BUF_LEN];
-FIFO_t syncRxFifo = {
-    .buffer = syncRxBuf,
-    .head = 0,
-    .tail = 0,
-    .maxlen = SYNC_RX_BUF_LEN
-};
-// Current byte being received
+// TX ring of fully stuffed line bits, first to send in bit 0 of each word
+uint32_t syncTxRing[SYNC_TX_RING_WORDS];
+// Next bit to write (only moved by the main loop) and next bit to send (only moved by the ISR)
+volatile uint16_t syncTxHead = 0;
+volatile uint16_t syncTxTail = 0;
+// Position within the idle flag being sent while the ring is empty
+volatile uint8_t syncTxIdlePos = 0;
+
+#ifdef HDLC_CTRL_FAST_LANE
+// TX ring of stuffed link control frames, sent ahead of the main ring at the next frame boundary
+uint32_t syncTxCtrlRing[SYNC_TX_CTRL_WORDS];
+volatile uint16_t syncTxCtrlHead = 0;
+volatile uint16_t syncTxCtrlTail = 0;
+// Main ring positions just past the closing flag of each frame, written by the main loop and consumed by the ISR
+volatile uint16_t syncTxMarks[SYNC_TX_MARKS];
+volatile uint8_t syncTxMarkHead = 0;
+volatile uint8_t syncTxMarkTail = 0;
+// Set by the ISR while the line is between frames (only the ISR uses this)
+bool syncTxBoundary = true;
+#endif
+
+/**
+ * A received frame (address through FCS), deframed straight into its slot by the ISR
+*/
+typedef struct {
+    uint16_t len;                       // number of bytes, including the FCS
+    bool fcsOk;                         // whether the FCS checked out
+    uint32_t tick;                      // HAL tick when the closing flag was received
+    uint8_t data[SYNC_RX_FRAME_MAX];
+} SyncRxSlot_t;
+
+// RX frame slots, the ISR fills the slot at the head and the main loop parses completed ones from the tail
+SyncRxSlot_t syncRxSlots[SYNC_RX_SLOTS];
+volatile uint8_t syncRxSlotHead = 0;
+volatile uint8_t syncRxSlotTail = 0;
+// Length and running CRC of the frame being received, and whether it's being dropped
+volatile uint16_t rxFrameLen = 0;
+volatile uint16_t rxFrameCrc = CRC16_CCITT_INIT_VAL;
+volatile bool rxFrameDrop = false;
+// Raw line bits waiting to be deframed
+volatile uint8_t rxRawBits = 0;
+volatile uint8_t rxRawCount = 0;
+// Flag search shift register
 volatile uint8_t rxCurrentByte = 0;
+// Destuffed bits of the byte being received
+volatile uint16_t rxDestuffed = 0;
 volatile uint8_t rxBitCounter = 0;
 volatile uint8_t byteStuffed = 255;
 
@@ -60,27 +85,298 @@ unsigned int SyncBytesReceived = 0;
 // For detecting RX bit stuffing
 volatile uint8_t rxOnesCounter = 0;
 
-// For TX bit stuffing
-volatile uint8_t txOnesCounter = 0;
-volatile uint8_t txLastBit = 0;
-
 volatile bool rxMsgInProgress = false;
 
-uint8_t rxCurMsg[SYNC_RX_BUF_LEN];
-uint16_t rxCurPos = 0;
-bool rxMsgStarted = false;
-bool rxMsgComplete = false;
-
 volatile unsigned long syncRxTimer = 50; // timer for delay after sync reset/drop/startup
 
+// Sync events waiting for the main loop. Only the context that runs the deframer posts events (which one
+// depends on the RX options), so there's a single producer and a single consumer and no locking is needed
+SyncEvent_t syncEvents[SYNC_EVENT_SLOTS];
+volatile uint8_t syncEventHead = 0;
+volatile uint8_t syncEventTail = 0;
+// Events dropped because the mailbox was full, and received frames dropped because there was no free slot
+volatile uint32_t syncEventsLost = 0;
+volatile uint32_t syncRxFrameDrops = 0;
+uint32_t syncEventsLostReported = 0;
+// Set while a no free slot event is waiting, so a stalled main loop only posts one event instead of one per frame
+volatile bool syncRxNoSlotPosted = false;
+
+// Timer that clocks the sync engine
+TIM_HandleTypeDef *syncTim = NULL;
+
+// Current line rate (bps), and the timer period schedule that synthesizes it (2 updates per bit)
+uint32_t syncLineRate = SYNC_DEFAULT_LINE_RATE;
+SyncClk_t syncLineClk = { .tim = TIM2, .div = 1 };
+
+// Supported line rates
+static const uint32_t syncLineRates[] = { 9600U, 19200U, 38400U, 56000U, 64000U };
+
+// Counts of the sync engine falling behind the line (timer interrupt or DMA block processing took too long)
+volatile uint32_t syncTimerOverruns = 0;
+volatile uint32_t syncRxOverruns = 0;
+volatile uint32_t syncTxOverruns = 0;
+
+// Digital PLL statistics: RXD transitions seen, how many came earlier/later than expected, and the total error in samples
+volatile uint32_t syncDpllTransitions = 0;
+volatile uint32_t syncDpllAhead = 0;
+volatile uint32_t syncDpllBehind = 0;
+volatile uint32_t syncDpllErrSum = 0;
+
+static uint32_t clkTimerFreq();
+static void clkConfigure(SyncClk_t *clk, uint32_t hz);
+
+#if (defined(SYNC_RX_DMA) || defined(SYNC_RX_SPI) || defined(SYNC_RX_OVERSAMPLE)) && defined(SYNC_TX_DMA)
+// Both directions are handled by DMA, so the update interrupt isn't needed
+#define SYNC_TIMER_NO_IRQ
+#endif
+
+#ifdef SYNC_TX_DMA
+// Circular table of GPIO BSRR words, written to the port by DMA on every TIM2 update (2 per bit)
+uint32_t syncTxWaveform[SYNC_TX_DMA_BITS * 2];
+static void txFillBlock(uint32_t *words, uint16_t bits);
+static void syncTxDmaHalfCplt(DMA_HandleTypeDef *hdma);
+static void syncTxDmaCplt(DMA_HandleTypeDef *hdma);
+#endif
+
+#ifdef SYNC_RX_DMA
+// Circular buffer of GPIO input samples, captured by DMA on every TIM2 update
+uint8_t syncRxSamples[SYNC_RX_DMA_SAMPLES];
+static void syncRxDmaHalfCplt(DMA_HandleTypeDef *hdma);
+static void syncRxDmaCplt(DMA_HandleTypeDef *hdma);
+#endif
+
+#ifdef SYNC_RX_SPI
+// SPI1 RX DMA, moves each byte shifted in from RXD into the line byte buffer
+DMA_HandleTypeDef hdma_spi1_rx;
+// Circular buffer of raw line bytes (not yet destuffed or aligned), first received bit in bit 0
+uint8_t syncRxSpiBuf[SYNC_RX_SPI_BYTES];
+static void rxSpiStart();
+#endif
+
+#ifdef SYNC_EXT_CLOCK
+// Timer clock, cached for the rate measurement
+uint32_t syncTimerFreq = 0;
+// Timer count at the last rising edge, and the periods summed since the measurement started
+volatile uint16_t syncExtClkLastCapture = 0;
+volatile uint32_t syncExtClkTicks = 0;
+volatile uint16_t syncExtClkPeriods = 0;
+// Timer ticks taken by the last SYNC_EXT_CLK_AVG_BITS periods, 0 until measured
+volatile uint32_t syncExtClkSum = 0;
+// HAL tick of the last edge, and whether we've noticed the clock is missing
+volatile uint32_t syncExtClkLastEdge = 0;
+bool syncExtClkLost = true;
+static void extClkStart();
+#endif
+
+#ifdef SYNC_RX_OVERSAMPLE
+// TIM3 update DMA, captures GPIO inputs SYNC_RX_OVERSAMPLE times per bit
+DMA_HandleTypeDef hdma_tim3_up;
+SyncClk_t syncRxOsClk = { .tim = TIM3, .div = 1 };
+// Circular buffer of oversampled GPIO inputs
+uint8_t syncRxOsSamples[SYNC_RX_OS_SAMPLES];
+// DPLL phase within the current bit (a whole bit is 65536, transitions should land on 0 and the bit is sampled at
+// 32768), the correction to the phase step per sample for the line's clock being off from ours, whether the current
+// bit has been sampled yet, and the last RXD level
+#define SYNC_DPLL_STEP      (65536U / SYNC_RX_OVERSAMPLE)
+// Most the step can be trimmed by, 1/16th of a bit per bit
+#define SYNC_DPLL_FREQ_MAX  ((int32_t)SYNC_DPLL_STEP / 16)
+uint16_t dpllPhase = 0;
+int16_t dpllFreq = 0;
+bool dpllSampled = false;
+uint8_t dpllLast = 0;
+static void rxOsStart();
+#endif
+
 /**
  * @brief Starts the timer interrupt handler
  * @param *tim pointer to the timer
 */
 void SyncStartup(TIM_HandleTypeDef *tim)
 {
+    BitStuffInit();
+    CrcInit();
+    syncTim = tim;
+    syncLineClk.tim = tim->Instance;
+    // Run the timer straight off the timer clock for the finest period resolution, and load the new prescaler
+    // before any DMA requests are enabled
+    #ifdef SYNC_EXT_CLOCK
+    // The timer just free-runs to timestamp the external clock edges
+    syncTimerFreq = clkTimerFreq();
+    __HAL_TIM_SET_AUTORELOAD(tim, 0xFFFF);
+    #else
+    clkConfigure(&syncLineClk, syncLineRate * 2U);
+    #endif
+    __HAL_TIM_SET_PRESCALER(tim, 0);
+    tim->Instance->EGR = TIM_EGR_UG;
+    __HAL_TIM_CLEAR_FLAG(tim, TIM_FLAG_UPDATE);
+    #ifdef SYNC_RX_DMA
+    // Capture GPIO inputs into the sample buffer on every timer update
+    hdma_tim2_up.XferHalfCpltCallback = syncRxDmaHalfCplt;
+    hdma_tim2_up.XferCpltCallback = syncRxDmaCplt;
+    HAL_DMA_Start_IT(&hdma_tim2_up, (uint32_t)&DCE_RXD_GPIO_Port->IDR, (uint32_t)syncRxSamples, SYNC_RX_DMA_SAMPLES);
+    __HAL_TIM_ENABLE_DMA(tim, TIM_DMA_UPDATE);
+    log_info("Sync RX DMA capture started");
+    #endif
+    #ifdef SYNC_RX_SPI
+    rxSpiStart();
+    log_info("Sync RX SPI shifter started");
+    #endif
+    #ifdef SYNC_RX_OVERSAMPLE
+    rxOsStart();
+    log_info("Sync RX oversampling started (%u samples per bit)", SYNC_RX_OVERSAMPLE);
+    #endif
+    #ifdef SYNC_TX_DMA
+    // Render the whole waveform table before we start, then refill each half as the DMA finishes it
+    txFillBlock(syncTxWaveform, SYNC_TX_DMA_BITS);
+    hdma_tim2_ch3.XferHalfCpltCallback = syncTxDmaHalfCplt;
+    hdma_tim2_ch3.XferCpltCallback = syncTxDmaCplt;
+    HAL_DMA_Start_IT(&hdma_tim2_ch3, (uint32_t)syncTxWaveform, (uint32_t)&DCE_TXCLK_GPIO_Port->BSRR, SYNC_TX_DMA_BITS * 2);
+    // Channel 3 is only used as a DMA trigger, its output is never enabled (PA2 is USART2 TX)
+    __HAL_TIM_SET_COMPARE(tim, TIM_CHANNEL_3, SYNC_TX_DMA_OFFSET);
+    __HAL_TIM_ENABLE_DMA(tim, TIM_DMA_CC3);
+    log_info("Sync TX DMA waveform started");
+    #endif
+    #ifdef SYNC_EXT_CLOCK
+    HAL_TIM_Base_Start(tim);
+    extClkStart();
+    log_info("Sync Serial following external clock on RXCLK");
+    #else
+    #ifdef SYNC_TIMER_NO_IRQ
+    HAL_TIM_Base_Start(tim);
+    #else
     HAL_TIM_Base_Start_IT(tim);
-    log_info("Sync Serial Clocks Started");
+    #endif
+    log_info("Sync Serial Clocks Started at %lu bps", syncLineRate);
+    #endif
+}
+
+/**
+ * @brief Get the clock feeding TIM2, which is doubled whenever APB1 is divided down
+ * @return timer clock in Hz
+*/
+static uint32_t clkTimerFreq()
+{
+    uint32_t freq = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+    {
+        freq *= 2U;
+    }
+    return freq;
+}
+
+/**
+ * @brief Work out the timer period schedule for an update rate
+ *
+ * The timer clock rarely divides evenly into the update rate, so the leftover is tracked and spread out
+ * as extra ticks (see clkStep()), which makes the long term rate exact
+ *
+ * @param *clk clock to configure
+ * @param hz timer updates per second
+*/
+static void clkConfigure(SyncClk_t *clk, uint32_t hz)
+{
+    uint32_t freq = clkTimerFreq();
+    __disable_irq();
+    clk->div = hz;
+    clk->period = freq / hz;
+    clk->frac = freq % hz;
+    clk->acc = 0;
+    __enable_irq();
+    clk->tim->ARR = clk->period - 1U;
+}
+
+/**
+ * @brief Set the timer period for the next block of timer updates
+ *
+ * Every update in the block gets the same period, since the ARR can only be changed once per interrupt. The leftover
+ * is carried between blocks so the error never grows beyond a tick per update in one block.
+ *
+ * @param *clk clock to step
+ * @param updates number of timer updates until this is called again
+*/
+static inline void clkStep(SyncClk_t *clk, uint16_t updates)
+{
+    uint32_t arr = clk->period - 1U;
+    clk->acc += clk->frac * updates;
+    if (clk->acc >= clk->div * updates)
+    {
+        clk->acc -= clk->div * updates;
+        arr++;
+    }
+    clk->tim->ARR = arr;
+}
+
+/**
+ * @brief Change the line rate, resetting the sync engine
+ * @param rate line rate in bps
+ * @return true on success, false if the rate isn't supported
+*/
+bool SyncSetLineRate(uint32_t rate)
+{
+    #ifdef SYNC_EXT_CLOCK
+    log_error("Can't set line rate to %lu bps, it's set by the external clock", rate);
+    return false;
+    #endif
+    bool valid = false;
+    for (uint8_t i = 0; i < sizeof(syncLineRates) / sizeof(syncLineRates[0]); i++)
+    {
+        if (syncLineRates[i] == rate) { valid = true; }
+    }
+    if (!valid)
+    {
+        log_error("Unsupported line rate %lu bps", rate);
+        return false;
+    }
+    syncLineRate = rate;
+    clkConfigure(&syncLineClk, rate * 2U);
+    #ifdef SYNC_RX_OVERSAMPLE
+    clkConfigure(&syncRxOsClk, rate * SYNC_RX_OVERSAMPLE);
+    #endif
+    syncTimerOverruns = 0;
+    syncRxOverruns = 0;
+    syncTxOverruns = 0;
+    syncDpllTransitions = 0;
+    syncDpllAhead = 0;
+    syncDpllBehind = 0;
+    syncDpllErrSum = 0;
+    log_info("Sync line rate set to %lu bps", rate);
+    VCPWriteDebug2("Sync line rate set to (x100 bps)", rate / 100U);
+    SyncReset();
+    return true;
+}
+
+/**
+ * @brief Get the current line rate
+ * @return line rate in bps (measured in external clock mode, 0 if the clock is missing)
+*/
+uint32_t SyncGetLineRate()
+{
+    #ifdef SYNC_EXT_CLOCK
+    uint32_t sum = syncExtClkSum;
+    if (syncExtClkLost || sum == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)syncTimerFreq * SYNC_EXT_CLK_AVG_BITS + sum / 2U) / sum);
+    #else
+    return syncLineRate;
+    #endif
+}
+
+/**
+ * @brief Check whether DMA has already finished the next half of a circular buffer
+ *
+ * The callback flags are cleared before the callbacks run, so if the other one is already set we
+ * took longer than a whole half buffer and the data we just handled was being overwritten.
+ *
+ * @param *hdma DMA handle
+ * @param half true if called from the half complete callback
+ * @return true if the DMA overran the callback
+*/
+static inline bool dmaOverrun(DMA_HandleTypeDef *hdma, bool half)
+{
+    uint32_t flag = half ? __HAL_DMA_GET_TC_FLAG_INDEX(hdma) : __HAL_DMA_GET_HT_FLAG_INDEX(hdma);
+    return __HAL_DMA_GET_FLAG(hdma, flag) != 0;
 }
 
 /**
@@ -88,397 +384,1149 @@ void SyncStartup(TIM_HandleTypeDef *tim)
 */
 void SyncReset()
 {
+    // Hold off RX processing in the interrupt handlers first, so they don't refill anything we clear below
+    syncRxTimer = HAL_GetTick();
     LED_ACT(0);
     // Reset RX
+    rxRawBits = 0;
+    rxRawCount = 0;
     rxCurrentByte = 0;
+    rxDestuffed = 0;
     rxBitCounter = 0;
+    rxOnesCounter = 0;
+    byteStuffed = 255;
+    rxMsgInProgress = false;
+    rxFrameLen = 0;
+    rxFrameDrop = false;
     SyncRxState = SEARCH;
     SyncBytesReceived = 0;
-    rxCurPos = 0;
-    rxMsgStarted = false;
-    rxMsgComplete = false;
-    FifoClear(&syncRxFifo);
-    // Reset TX
-    FifoClear(&syncTxFifo);
-    txOnesCounter = 0;
-    txLastBit = 0;
-    syncTxByte = 0;
-    syncTxBytePos = 0;
-    syncLastTxByte = 0;
-    syncTxFlag = false;
+    syncRxSlotTail = syncRxSlotHead;
+    // Reset TX, the tails belong to the ISR sending from the rings so it's held off while they're moved up to the heads
+    __disable_irq();
+    syncTxTail = syncTxHead;
+    #ifdef HDLC_CTRL_FAST_LANE
+    syncTxCtrlTail = syncTxCtrlHead;
+    syncTxMarkTail = syncTxMarkHead;
+    #endif
+    __enable_irq();
+    TxqReset();
     // Reset counters
     rxValidFrames = 0;
     rxTotalFrames = 0;
     txTotalFrames = 0;
     // Reset HDLC
     HdlcReset();
-    // Reset RX timer last
+    // Restart the RX delay from the end of the reset
     syncRxTimer = HAL_GetTick();
     // Log
     log_info("Reset Sync TX/RX");
     VCPWriteDebug1("Reset Sync TX/RX");
 }
 
+// Ring index math relies on the ring being a power of 2 in size, and 16 bit indexes
+_Static_assert((SYNC_TX_RING_WORDS & (SYNC_TX_RING_WORDS - 1)) == 0, "SYNC_TX_RING_WORDS must be a power of 2");
+_Static_assert(SYNC_TX_RING_BITS <= 65536U, "SYNC_TX_RING_BITS must fit a 16 bit index");
+#ifdef HDLC_CTRL_FAST_LANE
+_Static_assert((SYNC_TX_CTRL_WORDS & (SYNC_TX_CTRL_WORDS - 1)) == 0, "SYNC_TX_CTRL_WORDS must be a power of 2");
+_Static_assert((SYNC_TX_MARKS & (SYNC_TX_MARKS - 1)) == 0 && SYNC_TX_MARKS <= 128U, "SYNC_TX_MARKS must be a power of 2 up to 128");
+// An XID, the longest link control frame, with its FCS, worst case stuffing and closing & spacing flags has to fit
+_Static_assert((10U + 2U) * 10U + FRAME_SPACING * 8U < SYNC_TX_CTRL_WORDS * 32U, "SYNC_TX_CTRL_WORDS too small for an XID frame");
+#endif
+// A full size frame with its FCS, worst case stuffing and closing flag has to fit in the ring
+_Static_assert((HDLC_MAX_FRAME_SIZE_BYTES + 2U) * 10U + 8U < SYNC_TX_RING_BITS, "SYNC_TX_RING_WORDS too small for HDLC_MAX_FRAME_SIZE_BYTES");
+// Received frame lengths are 16 bit
+_Static_assert(SYNC_RX_FRAME_MAX <= 0xFFFFU, "HDLC_MAX_FRAME_SIZE_BYTES too large");
+
+/**
+ * @brief Get the number of free bits in the TX ring
+ * @param head write position to measure from
+ * @return free bits (one bit is always kept free so a full ring can be told from an empty one)
+*/
+static inline uint16_t txRingFree(uint16_t head)
+{
+    return (syncTxTail - head - 1) & (SYNC_TX_RING_BITS - 1);
+}
+
+/**
+ * @brief Write line bits into a TX ring at a position that isn't visible to the ISR yet
+ * @param *ring the ring (the main or control ring)
+ * @param words ring size in 32-bit words
+ * @param *head write position, advanced past the new bits
+ * @param bits the bits to write, first to send in bit 0
+ * @param count number of bits to write (1-8)
+*/
+static inline void txRingPut(uint32_t *ring, uint16_t words, uint16_t *head, uint8_t bits, uint8_t count)
+{
+    uint16_t word = *head >> 5;
+    uint8_t shift = *head & 31;
+    // Only touch the bits being written, when the ring is nearly full the rest of the word can still be waiting to go
+    uint32_t mask = (1UL << count) - 1;
+    uint32_t put = bits & mask;
+    ring[word] = (ring[word] & ~(mask << shift)) | (put << shift);
+    if (shift + count > 32)
+    {
+        uint16_t next = (word + 1) & (words - 1);
+        ring[next] = (ring[next] & ~(mask >> (32 - shift))) | (put >> (32 - shift));
+    }
+    *head = (*head + count) & (words * 32U - 1);
+}
+
+/**
+ * @brief Hand bits written to the ring over to the ISR
+ * @param head new write position
+*/
+static inline void txRingCommit(uint16_t head)
+{
+    // Make sure the ring writes land before the ISR can see them
+    __DMB();
+    syncTxHead = head;
+}
+
+/**
+ * @brief Bit stuff a byte into a TX ring, LSB first
+ * @param *ring the ring
+ * @param words ring size in 32-bit words
+ * @param *head write position, advanced past the new bits
+ * @param *ones number of consecutive 1s sent so far, updated
+ * @param byte the byte to stuff
+*/
+static inline void txRingStuffByte(uint32_t *ring, uint16_t words, uint16_t *head, uint8_t *ones, uint8_t byte)
+{
+    const StuffEntry_t *lo = &stuffTable[*ones][byte & 0xF];
+    txRingPut(ring, words, head, lo->bits, lo->count);
+    const StuffEntry_t *hi = &stuffTable[lo->ones][byte >> 4];
+    txRingPut(ring, words, head, hi->bits, hi->count);
+    *ones = hi->ones;
+}
+
+/**
+ * @brief Bit stuff a frame, its FCS and a closing flag into a TX ring
+ *
+ * The FCS is calculated in the same pass as the stuffing, so each frame byte is only read once
+ *
+ * @param *ring the ring
+ * @param words ring size in 32-bit words
+ * @param *head write position, advanced past the new bits
+ * @param *data frame bytes from the address on, without the FCS
+ * @param len number of bytes
+*/
+static inline void txRingStuffFrame(uint32_t *ring, uint16_t words, uint16_t *head, const uint8_t *data, uint16_t len)
+{
+    // Frames always follow a flag, which ends in a 0
+    uint8_t ones = 0;
+    uint16_t crc = CrcStart();
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc = CrcUpdateByte(crc, data[i]);
+        txRingStuffByte(ring, words, head, &ones, data[i]);
+    }
+    uint16_t fcs = CrcFinal(crc);
+    txRingStuffByte(ring, words, head, &ones, low(fcs));
+    txRingStuffByte(ring, words, head, &ones, high(fcs));
+    txRingPut(ring, words, head, HDLC_SYNC_WORD, 8);
+}
+
 /**
- * @brief Add byte to syncronous serial TX buffer
- * @param byte the byte to add
- * @return true on success, false on failure
+ * @brief Bit stuff a frame and its FCS into the TX ring, followed by a closing flag
+ *
+ * This runs in the main loop, so the ISR only ever has to shift out ready-made line bits. The frame
+ * is only handed to the ISR once it's complete, so an idle flag can never end up in the middle of it.
+ *
+ * @param *data frame bytes from the address on, without the FCS
+ * @param len number of bytes
+ * @return true on success, false if the ring is out of space
 */
-bool SyncAddTxByte(const uint8_t byte)
+bool SyncAddTxFrame(const uint8_t *data, uint16_t len)
 {
-    if (FifoPush(&syncTxFifo, byte))
+    uint16_t head = syncTxHead;
+    // Each nibble can grow by at most one stuffed bit, plus the FCS and closing flag
+    if (txRingFree(head) < ((uint32_t)len + 2U) * 10U + 8U)
     {
         log_error("Sync TX buffer out of space!");
         return false;
     }
+    txRingStuffFrame(syncTxRing, SYNC_TX_RING_WORDS, &head, data, len);
+    #ifdef HDLC_CTRL_FAST_LANE
+    // Mark the end of the frame, so the ISR knows it can slip a control frame in there. If the marks are all in
+    // use the frame just doesn't get one, and a control frame waits for a later boundary.
+    uint8_t mark = syncTxMarkHead;
+    if ((uint8_t)(mark - syncTxMarkTail) < SYNC_TX_MARKS)
+    {
+        syncTxMarks[mark & (SYNC_TX_MARKS - 1)] = head;
+        __DMB();
+        syncTxMarkHead = mark + 1;
+    }
+    #endif
+    txRingCommit(head);
     return true;
 }
 
-bool SyncAddTxBytes(const uint8_t *bytes, unsigned int len)
+#ifdef HDLC_CTRL_FAST_LANE
+/**
+ * @brief Bit stuff a link control frame into the control ring, followed by a closing flag and spacing flags
+ *
+ * The ISR sends it at the next frame boundary in the main ring (or straight away if that's idle)
+ *
+ * @param *data frame bytes from the address on, without the FCS
+ * @param len number of bytes
+ * @param flags number of flags to add after the closing flag
+ * @return true on success, false if the ring is out of space
+*/
+bool SyncAddTxCtrlFrame(const uint8_t *data, uint16_t len, uint8_t flags)
 {
-    if (len > SYNC_TX_BUF_LEN)
+    uint16_t head = syncTxCtrlHead;
+    uint16_t room = (syncTxCtrlTail - head - 1) & (SYNC_TX_CTRL_BITS - 1);
+    if (room < ((uint32_t)len + 2U) * 10U + 8U + (uint16_t)flags * 8U)
     {
-        log_error("Tried to add more TX bytes than TX buffer supports!");
+        log_error("Sync TX control buffer out of space!");
         return false;
     }
-    for (unsigned int i=0; i<len; i++)
+    txRingStuffFrame(syncTxCtrlRing, SYNC_TX_CTRL_WORDS, &head, data, len);
+    for (uint8_t i = 0; i < flags; i++)
     {
-        if (!SyncAddTxByte(bytes[i]))
-        {
-            log_error("Sync TX buffer ran out of space!");
-            return false;
-        }
+        txRingPut(syncTxCtrlRing, SYNC_TX_CTRL_WORDS, &head, HDLC_SYNC_WORD, 8);
     }
+    // Make sure the ring writes land before the ISR can see them
+    __DMB();
+    syncTxCtrlHead = head;
     return true;
 }
+#endif
 
-void NextTxByte()
+/**
+ * @brief Get the current end of the data queued in a TX ring, to check for with SyncTxMarkSent
+ * @param ctrl the control ring rather than the main one
+*/
+uint16_t SyncGetTxMark(bool ctrl)
 {
-    // Reset flag
-    syncTxFlag = false;
-    
-    // Check if we have data to send, and pop until we don't
-    if (FifoPop(&syncTxFifo, &syncTxByte))
+    #ifdef HDLC_CTRL_FAST_LANE
+    if (ctrl)
     {
-        syncTxByte = HDLC_SYNC_WORD;
-        LED_ACT(0);
+        return syncTxCtrlHead;
     }
-    else
+    #endif
+    return syncTxHead;
+}
+
+/**
+ * @brief Check if everything queued in a TX ring up to a mark has been sent
+ * @param ctrl the control ring rather than the main one
+ * @param mark position from SyncGetTxMark
+*/
+bool SyncTxMarkSent(bool ctrl, uint16_t mark)
+{
+    uint16_t head = syncTxHead;
+    uint16_t tail = syncTxTail;
+    uint16_t mask = SYNC_TX_RING_BITS - 1;
+    #ifdef HDLC_CTRL_FAST_LANE
+    if (ctrl)
     {
-        LED_ACT(1);
+        head = syncTxCtrlHead;
+        tail = syncTxCtrlTail;
+        mask = SYNC_TX_CTRL_BITS - 1;
     }
+    #endif
+    // Sent once what's left to send is no more than what's been added since the mark
+    return ((head - tail) & mask) <= ((head - mark) & mask);
+}
 
-    // If we got a true flag, note it
-    if (syncTxByte == HDLC_SYNC_WORD) { syncTxFlag = true; }
-    // Unescape things if needed
-    if (syncTxByte == HDLC_ESCAPE_CODE)
+/**
+ * @brief Add flags to the TX ring (between frames, flags are also sent whenever the ring is empty)
+ * @param count number of flags to add
+ * @return true on success, false if the ring is out of space
+*/
+bool SyncAddTxFlags(uint8_t count)
+{
+    uint16_t head = syncTxHead;
+    if (txRingFree(head) < (uint16_t)count * 8U)
     {
-        // Figure out the escaped byte
-        if (FifoPop(&syncTxFifo, &syncTxByte))
-        {
-            log_error("Got escape character but nothing following!");
-            return;
-        }
-        // Escape the 0x7D
-        if (syncTxByte == HDLC_ESCAPE_7D)
-        {
-            syncTxByte = 0x7D;
-        }
-        // Escape the 0x7E and note that it's not a flag
-        else if (syncTxByte == HDLC_ESCAPE_7E)
-        {
-            syncTxByte = 0x7E; 
-            syncTxFlag = false;
-        }
+        log_error("Sync TX buffer out of space!");
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        txRingPut(syncTxRing, SYNC_TX_RING_WORDS, &head, HDLC_SYNC_WORD, 8);
     }
+    txRingCommit(head);
+    return true;
 }
 
+/**
+ * @brief Get the next line bit to send, called from the ISR
+ *
+ * The ring only ever contains whole flags and frames, so we can switch between it and idle flags at any flag boundary.
+ * With HDLC_CTRL_FAST_LANE, link control frames are sent from their own ring as soon as the line reaches the end of
+ * an idle flag or of a marked frame in the main ring, and the main ring carries on once they're done.
+ *
+ * @return the bit to send
+*/
 bool NextTxBit()
 {
-    // Check for stuffing first
-    if (txOnesCounter == 5 && !syncTxFlag)
+    #ifdef HDLC_CTRL_FAST_LANE
+    // The control ring only holds whole frames, so once we've started on it we're back at a boundary when it's empty
+    uint16_t ctrlTail = syncTxCtrlTail;
+    if (syncTxBoundary && ctrlTail != syncTxCtrlHead)
     {
-        // Reset the counter
-        txOnesCounter = 0;
-        // Don't increment the position counter and return an extra 0
-        return 0;
+        if ((ctrlTail & 0x7) == 0) { LED_ACT(1); }
+        bool bit = (syncTxCtrlRing[ctrlTail >> 5] >> (ctrlTail & 31)) & 0x1;
+        syncTxCtrlTail = (ctrlTail + 1) & (SYNC_TX_CTRL_BITS - 1);
+        return bit;
     }
-    else
+    #endif
+    uint16_t tail = syncTxTail;
+    // Only go back to the ring once any idle flag we started is finished
+    if (syncTxIdlePos == 0 && tail != syncTxHead)
     {
-        // Increment the bit in our current byte
-        syncTxBytePos++;
-        // Get the next byte if we've done all 8 bits
-        if (syncTxBytePos >= 8)
+        if ((tail & 0x7) == 0) { LED_ACT(1); }
+        bool bit = (syncTxRing[tail >> 5] >> (tail & 31)) & 0x1;
+        tail = (tail + 1) & (SYNC_TX_RING_BITS - 1);
+        syncTxTail = tail;
+        #ifdef HDLC_CTRL_FAST_LANE
+        // See if that was the last bit of a frame
+        uint8_t mark = syncTxMarkTail;
+        syncTxBoundary = mark != syncTxMarkHead && syncTxMarks[mark & (SYNC_TX_MARKS - 1)] == tail;
+        if (syncTxBoundary)
         {
-            syncTxBytePos = 0;
-            NextTxByte();
+            syncTxMarkTail = mark + 1;
         }
-        // Get new bit
-        txLastBit = GetBitAtPos(syncTxByte, syncTxBytePos);
-        // If it's a 1, increment our ones counter
-        if (txLastBit) {
-            txOnesCounter++;
-        // If it's a zero, reset our ones counter
-        } else {
-            txOnesCounter = 0;
-        }
-        return txLastBit;
+        #endif
+        return bit;
+    }
+    if (syncTxIdlePos == 0) { LED_ACT(0); }
+    bool bit = (HDLC_SYNC_WORD >> syncTxIdlePos) & 0x1;
+    syncTxIdlePos = (syncTxIdlePos + 1) & 0x7;
+    #ifdef HDLC_CTRL_FAST_LANE
+    syncTxBoundary = syncTxIdlePos == 0;
+    #endif
+    return bit;
+}
+
+#ifdef SYNC_TX_DMA
+
+/**
+ * @brief Render the next bits of the TX bitstream into GPIO BSRR words
+ *
+ * Each bit takes two timer updates: the first raises TXCLK and sets TXD, the second drops TXCLK
+ *
+ * @param *words pointer to the first word to write
+ * @param bits number of bits to render
+*/
+static void txFillBlock(uint32_t *words, uint16_t bits)
+{
+    for (uint16_t i = 0; i < bits; i++)
+    {
+        // BSRR low half sets pins, high half resets them
+        uint32_t txd = NextTxBit() ? DCE_TXD_Pin : ((uint32_t)DCE_TXD_Pin << 16);
+        words[2 * i] = DCE_TXCLK_Pin | txd;
+        words[2 * i + 1] = (uint32_t)DCE_TXCLK_Pin << 16;
     }
 }
 
 /**
- * @brief called from main loop and tries to parse bytes from the fifo into messages
+ * @brief TX waveform DMA half complete callback, refills the first half of the table while the second half is sent
+*/
+static void syncTxDmaHalfCplt(DMA_HandleTypeDef *hdma)
+{
+    txFillBlock(syncTxWaveform, SYNC_TX_DMA_BITS / 2);
+    #ifdef SYNC_TIMER_NO_IRQ
+    clkStep(&syncLineClk, SYNC_TX_DMA_BITS);
+    #endif
+    if (dmaOverrun(hdma, true)) { syncTxOverruns++; }
+}
+
+/**
+ * @brief TX waveform DMA complete callback, refills the second half of the table while the first half is sent
+*/
+static void syncTxDmaCplt(DMA_HandleTypeDef *hdma)
+{
+    txFillBlock(syncTxWaveform + SYNC_TX_DMA_BITS, SYNC_TX_DMA_BITS / 2);
+    #ifdef SYNC_TIMER_NO_IRQ
+    clkStep(&syncLineClk, SYNC_TX_DMA_BITS);
+    #endif
+    if (dmaOverrun(hdma, false)) { syncTxOverruns++; }
+}
+
+#endif
+
+/**
+ * @brief called from main loop and parses any frames the ISR has finished receiving
 */
 void RxMessageCallback()
 {
-    // Do nothing without sync
-    if (SyncRxState != SYNCED) {
-        // Clear the buffer if it's not empty
-        if (syncRxFifo.size > 0)
+    while (syncRxSlotTail != syncRxSlotHead)
+    {
+        uint8_t tail = syncRxSlotTail;
+        // Make sure we read the slot after seeing the head that published it
+        __DMB();
+        SyncRxSlot_t *slot = &syncRxSlots[tail & (SYNC_RX_SLOTS - 1)];
+        LED_ACT(1);
+        // If we fail to parse the message, drop sync (which also throws away any other received frames)
+        if (HDLCParseMsg(slot->data, slot->len, slot->fcsOk, slot->tick))
         {
-            log_warn("RX not synced, clearing RX FIFO (had %d bytes)", syncRxFifo.size);
-            FifoClear(&syncRxFifo);
+            log_error("Failed to parse RX HDLC message");
+            VCPWriteDebug1("Failed to parse RX HDLC message");
+            SyncReset();
+            break;
         }
+        // Hand the slot back once we're done with it
+        __DMB();
+        syncRxSlotTail = tail + 1;
+        LED_ACT(0);
+    }
+}
+
+/**
+ * @brief Queue an event for the main loop (interrupt context only)
+ * @param code event code
+ * @param arg event specific value
+*/
+static void syncPostEvent(uint8_t code, uint32_t arg)
+{
+    uint8_t head = syncEventHead;
+    if ((uint8_t)(head - syncEventTail) >= SYNC_EVENT_SLOTS)
+    {
+        syncEventsLost++;
         return;
     }
+    syncEvents[head & (SYNC_EVENT_SLOTS - 1)] = (SyncEvent_t){ .code = code, .arg = arg };
+    // Make sure the record lands before the main loop can see it
+    __DMB();
+    syncEventHead = head + 1;
+}
+
+/**
+ * @brief Stop RX processing until the main loop has reset sync (interrupt context only)
+ *
+ * This puts the deframer back to searching and starts the RX delay, which stops the interrupt handlers
+ * feeding it any more bits, then leaves the rest of the reset to SyncEventCallback
+ *
+ * @param code event code to post
+ * @param arg event specific value
+*/
+static void rxHalt(uint8_t code, uint32_t arg)
+{
+    SyncRxState = SEARCH;
+    syncRxTimer = HAL_GetTick();
+    syncPostEvent(code, arg);
+}
 
-    // Pop bytes from Fifo until the next sync word
-    uint8_t newByte = 0;
-    while (!FifoPop(&syncRxFifo, &newByte) && !rxMsgComplete)
+/**
+ * @brief Start receiving a frame into the slot at the head, or drop it if the main loop hasn't freed one
+*/
+static inline void rxFrameStart()
+{
+    rxFrameLen = 0;
+    rxFrameCrc = CrcStart();
+    rxFrameDrop = (uint8_t)(syncRxSlotHead - syncRxSlotTail) >= SYNC_RX_SLOTS;
+    if (rxFrameDrop)
     {
-        LED_ACT(1);
-        #ifdef TRACE_SYNC
-        log_trace("Popped %02X from RX FIFO",newByte);
-        #endif
-        // Check for two repeating sync words which delineate 
-        if (newByte == HDLC_SYNC_WORD)
+        syncRxFrameDrops++;
+        if (!syncRxNoSlotPosted)
         {
-            if (!rxMsgStarted) {
-                rxMsgStarted = true;
-            }
-            else
-            {
-                rxMsgComplete = true;
-            }
+            syncRxNoSlotPosted = true;
+            syncPostEvent(SYNC_EVT_RX_NO_SLOT, 0);
         }
-        else
+    }
+}
+
+/**
+ * @brief Add a data byte to the frame being received, and run it through the FCS
+ * @param byte the received byte
+*/
+static inline void rxFrameByte(uint8_t byte)
+{
+    if (rxFrameDrop)
+    {
+        return;
+    }
+    // A corrupted closing flag can run the frame on forever, drop it and wait for the next flag
+    if (rxFrameLen >= SYNC_RX_FRAME_MAX)
+    {
+        rxFrameDrop = true;
+        syncPostEvent(SYNC_EVT_RX_TOO_LONG, 0);
+        return;
+    }
+    syncRxSlots[syncRxSlotHead & (SYNC_RX_SLOTS - 1)].data[rxFrameLen++] = byte;
+    rxFrameCrc = CrcUpdateByte(rxFrameCrc, byte);
+}
+
+/**
+ * @brief Finish the frame being received on its closing flag, and hand it to the main loop
+*/
+static inline void rxFrameEnd()
+{
+    // Single bytes between flags are line noise rather than frames
+    if (rxFrameDrop || rxFrameLen < 2)
+    {
+        return;
+    }
+    SyncRxSlot_t *slot = &syncRxSlots[syncRxSlotHead & (SYNC_RX_SLOTS - 1)];
+    slot->len = rxFrameLen;
+    // Running the CRC over a frame and its own FCS always leaves the same residue
+    slot->fcsOk = rxFrameLen >= 4 && rxFrameCrc == CRC16_X25_RESIDUE;
+    slot->tick = HAL_GetTick();
+    // Make sure the slot lands before the main loop can see it
+    __DMB();
+    syncRxSlotHead++;
+}
+
+/**
+ * @brief Handle a fully destuffed byte from the line
+ *
+ * Data bytes go straight into the current frame slot, and flags start and finish frames
+ *
+ * @param byte the received byte
+*/
+static void rxByte(uint8_t byte)
+{
+    if (byte == HDLC_SYNC_WORD && byteStuffed != 6)
+    {
+        // A real flag can't have a stuffed bit in it, so this ends any frame in progress
+        if (rxMsgInProgress)
         {
-            if (rxMsgStarted)
-            {
-                rxCurMsg[rxCurPos] = newByte;
-                rxCurPos++;
-            }
+            rxMsgInProgress = false;
+            rxFrameEnd();
         }
+        return;
     }
-    // Process the complete message
-    if (rxMsgComplete)
+    // Data 0x7E bytes always have a stuffed bit after their fifth 1, and are kept as data
+    if (!rxMsgInProgress)
     {
-        if (rxCurPos > 1)
-        {
-            // If we fail to parse the message, drop sync
-            if (HDLCParseMsg(rxCurMsg, rxCurPos)) // minus 1 to remove the trailing flag (TODO: make it smarter)
+        rxMsgInProgress = true;
+        rxFrameStart();
+    }
+    rxFrameByte(byte);
+}
+
+/**
+ * @brief Drop sync after receiving 7 consecutive 1s
+*/
+static void rxAbort()
+{
+    rxHalt(SYNC_EVT_RX_ABORT, 0);
+}
+
+/**
+ * @brief Slow path for a single synced RX bit, only used to get back to nibble alignment after sync is found
+ * @param bit the received bit
+*/
+static void rxDestuffBit(uint8_t bit)
+{
+    uint8_t ones = rxOnesCounter;
+    uint8_t res = BitStuffRxStep(&ones, bit);
+    rxOnesCounter = ones;
+    switch (res)
+    {
+        case DESTUFF_DROP:
+            // note the location of the stuffed bit (important to differentiate a flag)
+            byteStuffed = rxBitCounter;
+            break;
+        case DESTUFF_ABORT:
+            rxAbort();
+            break;
+        default:
+            rxDestuffed |= bit << rxBitCounter;
+            rxBitCounter++;
+            if (rxBitCounter == 8)
             {
-                log_error("Failed to parse RX HDLC message");
-                VCPWriteDebug1("Failed to parse RX HDLC message");
-                SyncReset();
+                rxByte((uint8_t)rxDestuffed);
+                byteStuffed = 255;
+                rxDestuffed = 0;
+                rxBitCounter = 0;
             }
-        }
-        
-        // Reset
-        rxCurPos = 0;
-        rxMsgStarted = false;
-        rxMsgComplete = false;
-        LED_ACT(0);
+            break;
     }
 }
 
-void RxBits()
+/**
+ * @brief Fast path for 4 synced RX bits, destuffed in one table lookup
+ * @param nibble the received bits, first received in bit 0
+*/
+static void rxDestuffNibble(uint8_t nibble)
 {
-    // Wait for timeout to clear
-    if (HAL_GetTick() - syncRxTimer < SYNC_RX_DELAY) {
-        return;
-    // 0 is our "done" state so we only print the log message once
-    } else if (syncRxTimer > 0) {
-        log_info("Sync RX starting");
-        VCPWriteDebug1("Sync RX starting");
-        syncRxTimer = 0;
+    const DestuffEntry_t *entry = &destuffTable[rxOnesCounter][nibble];
+
+    // Work out which destuffed bit position the stuffed bit (if any) was dropped before
+    uint8_t stuffAt = 255;
+    if (entry->flags & DESTUFF_FLAG_STUFFED)
+    {
+        stuffAt = rxBitCounter + entry->stuffPos;
+        if (stuffAt < 8) { byteStuffed = stuffAt; }
+    }
+
+    // Append the destuffed bits
+    rxDestuffed |= entry->bits << rxBitCounter;
+    rxBitCounter += entry->count;
+    rxOnesCounter = entry->ones;
+
+    // Handle a completed byte
+    if (rxBitCounter >= 8)
+    {
+        rxByte((uint8_t)rxDestuffed);
+        // A stuffed bit after the end of the byte belongs to the next one
+        byteStuffed = (stuffAt != 255 && stuffAt >= 8) ? stuffAt - 8 : 255;
+        rxDestuffed >>= 8;
+        rxBitCounter -= 8;
     }
-    // Read the state of each RX pin
-    bool rxd = GET_RXD();
-    //bool rts = GET_RTS();
-    // Shift the latest RX bit into the byte buffer (from the left since we receive bits LSB-first)
-    rxCurrentByte = (rxCurrentByte >> 1) | (rxd << 7);
-    //log_trace("RX state: %d, Current RX byte: %02X ("BYTE_TO_BINARY_PATTERN")", SyncRxState, rxCurrentByte, BYTE_TO_BINARY(rxCurrentByte));
-    // Do different things depending on state
+
+    if (entry->flags & DESTUFF_FLAG_ABORT)
+    {
+        rxAbort();
+    }
+}
+
+/**
+ * @brief Process 8 raw bits received from the line
+ *
+ * While searching, bits are shifted one at a time looking for a flag. Once synced,
+ * bits are destuffed a nibble at a time via the lookup table in bitstuff.c
+ *
+ * @param bits the received bits, first received in bit 0
+*/
+void SyncRxDeframe(uint8_t bits)
+{
+    uint8_t pos = 0;
+
     switch (SyncRxState)
     {
         // searching for the HDLC sync frame
-        case SEARCH:      
-            // Check what's currently in there
-            if (rxCurrentByte == HDLC_SYNC_WORD)
-            {
-                // Switch state to synced and reset the current byte
-                SyncRxState = SYNCED;
-                log_info("HDLC RX now synced");
-                VCPWriteDebug1("HDLC RX now synced");
-                rxCurrentByte = 0;
-                rxBitCounter = 0;
-            }
-            break;
-        
-        // If we're synced, process bits & bytes like normal
-        case SYNCED:
-            // If we've received 5 1s and the next bit is 0, that's a stuffed bit and we should ignore
-            if (rxOnesCounter == 5 && rxd == 0)
-            {
-                //log_debug("Got a stuffed bit, skipping");
-                // note the location of the stuffed bit (important to differentiate a flag below)
-                byteStuffed = rxBitCounter;
-                // Reset the counter
-                rxOnesCounter = 0;
-                // shift over 1 (dropping the last bit received) and dont increment the bit counter
-                rxCurrentByte <<= 1;
-            }
-            // If we've received 6 1s and the next bit is also a 1, that can't happen normally and we should drop sync
-            else if (rxOnesCounter == 6 && rxd == 1)
-            {
-                log_error("Received 7 consecutive 1s, this is bad.");
-                VCPWriteDebug1("Received 7 consecutive 1s, this is bad.");
-                SyncReset();
-            }
-            else
+        case SEARCH:
+            while (pos < 8)
             {
-                // Increment the ones counter if needed
-                if (rxd) { rxOnesCounter += 1; } else { rxOnesCounter = 0; }
-                
-                // Increment the bit counter
-                rxBitCounter++;
-                // If we've received 8 bits, push the byte to the Fifo and reset
-                if (rxBitCounter == 8)
+                // Shift the latest RX bit into the byte buffer (from the left since we receive bits LSB-first)
+                rxCurrentByte = (rxCurrentByte >> 1) | (((bits >> pos) & 0x1) << 7);
+                pos++;
+                if (rxCurrentByte == HDLC_SYNC_WORD)
                 {
-                    if (rxCurrentByte == HDLC_SYNC_WORD) {
-                        // If we got a sync word, check to see if there was a message being sent
-                        if (rxMsgInProgress)
-                        {
-                            // If the byte was stuffed at position 6, it's not actually a sync word so escape it
-                            if (byteStuffed == 6)
-                            {
-                                uint8_t res = 0;
-                                res += FifoPush(&syncRxFifo, HDLC_ESCAPE_CODE);
-                                res += FifoPush(&syncRxFifo, HDLC_ESCAPE_7E);
-                                if (res != 0)
-                                {
-                                    log_warn("syncRxFifo full!");
-                                }
-                            }
-                            else
-                            {
-                                // Message is done
-                                rxMsgInProgress = false;
-                                // Append tailing sync word so RxCallback can find the end
-                                if (FifoPush(&syncRxFifo, HDLC_SYNC_WORD))
-                                {
-                                    log_warn("syncRxFifo full!");
-                                }
-                            }
-                        }
-                    }
-                    // If the byte isn't a sync word, put it in the fifo
-                    else
-                    {
-                        // message now in progress
-                        if (!rxMsgInProgress)
-                        {
-                            // Set flag
-                            rxMsgInProgress = true;
-                            // Push starting sync word so RxCallback can find the start
-                            if (FifoPush(&syncRxFifo, HDLC_SYNC_WORD))
-                            {
-                                log_warn("syncRxFifo full!");
-                            }
-                        }
-                        // Escape 0x7D if it comes up
-                        if (rxCurrentByte == 0x7D)
-                        {
-                            uint8_t res = 0;
-                            res += FifoPush(&syncRxFifo, HDLC_ESCAPE_CODE);
-                            res += FifoPush(&syncRxFifo, HDLC_ESCAPE_7D);
-                            if (res != 0)
-                            {
-                                log_warn("syncRxFifo full!");
-                            }
-                        }
-                        else
-                        {
-                            if (FifoPush(&syncRxFifo, rxCurrentByte))
-                            {
-                                log_warn("syncRxFifo full!");
-                            }
-                        }
-                    }
-                    // Reset everything
-                    byteStuffed = 255;
+                    // Switch state to synced and reset the current byte
+                    SyncRxState = SYNCED;
+                    syncPostEvent(SYNC_EVT_RX_SYNCED, 0);
                     rxCurrentByte = 0;
+                    rxDestuffed = 0;
                     rxBitCounter = 0;
-                    
-                }
-                else if (rxBitCounter > 8)
-                {
-                    log_error("RX bit counter exceeded");
-                    VCPWriteDebug1("RX bit counter exceeded");
-                    SyncReset();
+                    rxOnesCounter = 0;
+                    byteStuffed = 255;
+                    break;
                 }
             }
-            
-        break;
+            // Process single bits until we're back on a nibble boundary
+            while (SyncRxState == SYNCED && (pos & 0x3))
+            {
+                rxDestuffBit((bits >> pos) & 0x1);
+                pos++;
+            }
+            break;
+
+        // If we're synced, process bits & bytes like normal
+        case SYNCED:
+            break;
 
         default:
-            log_error("RX sync state machine got invalid state %d", SyncRxState);
-            VCPWriteDebug2("RX sync state machine got invalid state", SyncRxState);
-            SyncRxState = SEARCH;
-            SyncReset();
-        break;
+            rxHalt(SYNC_EVT_RX_BAD_STATE, SyncRxState);
+            return;
+    }
+
+    // Destuff the remaining nibbles
+    while (SyncRxState == SYNCED && pos < 8)
+    {
+        rxDestuffNibble((bits >> pos) & 0xF);
+        pos += 4;
+    }
+}
+
+/**
+ * @brief Check whether the RX startup/reset delay has elapsed
+ * @return true if received bits should be processed
+*/
+static bool rxReady()
+{
+    // Wait for timeout to clear
+    if (HAL_GetTick() - syncRxTimer < SYNC_RX_DELAY) {
+        return false;
+    // 0 is our "done" state so we only print the log message once
+    } else if (syncRxTimer > 0) {
+        syncPostEvent(SYNC_EVT_RX_START, 0);
+        syncRxTimer = 0;
+        rxRawBits = 0;
+        rxRawCount = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Add a received bit to the raw bit buffer, and deframe once we have a full byte
+ * @param bit the received bit
+ * @return true if a full byte was deframed
+*/
+static inline bool rxPushBit(uint8_t bit)
+{
+    rxRawBits |= bit << rxRawCount;
+    rxRawCount++;
+    if (rxRawCount == 8)
+    {
+        SyncRxDeframe(rxRawBits);
+        rxRawBits = 0;
+        rxRawCount = 0;
+        return true;
+    }
+    return false;
+}
+
+void RxBits()
+{
+    if (!rxReady())
+    {
+        return;
+    }
+    // Read the state of the RX pin
+    rxPushBit(GET_RXD());
+}
+
+#ifdef SYNC_RX_DMA
+
+// Only the low byte of GPIOB IDR is captured, so both pins need to live there (they also need to share a port)
+_Static_assert((DCE_RXD_Pin | DCE_TXCLK_Pin) <= 0xFFU, "RX DMA capture requires RXD and TXCLK in GPIO bits 0-7");
+
+/**
+ * @brief Process a block of captured GPIO samples
+ *
+ * Samples are captured on every TIM2 update (twice per bit). We keep the ones taken while TXCLK
+ * was still low, which are the updates where the clock is about to rise and the old code sampled RXD.
+ *
+ * @param *samples pointer to the first sample
+ * @param len number of samples
+*/
+static void rxSampleBlock(const uint8_t *samples, uint16_t len)
+{
+    if (!rxReady())
+    {
+        return;
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (samples[i] & DCE_TXCLK_Pin)
+        {
+            continue;
+        }
+        // Stop if the deframer reset sync, the rest of the block falls within the reset delay
+        if (rxPushBit((samples[i] & DCE_RXD_Pin) != 0) && syncRxTimer > 0)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief RX capture DMA half complete callback, processes the first half of the sample buffer
+*/
+static void syncRxDmaHalfCplt(DMA_HandleTypeDef *hdma)
+{
+    rxSampleBlock(syncRxSamples, SYNC_RX_DMA_SAMPLES / 2);
+    if (dmaOverrun(hdma, true)) { syncRxOverruns++; }
+}
+
+/**
+ * @brief RX capture DMA complete callback, processes the second half of the sample buffer
+*/
+static void syncRxDmaCplt(DMA_HandleTypeDef *hdma)
+{
+    rxSampleBlock(syncRxSamples + SYNC_RX_DMA_SAMPLES / 2, SYNC_RX_DMA_SAMPLES / 2);
+    if (dmaOverrun(hdma, false)) { syncRxOverruns++; }
+}
+
+#endif
+
+#ifdef SYNC_RX_SPI
+
+/**
+ * @brief Deframe a block of raw line bytes shifted in by SPI1
+ * @param *bytes pointer to the first byte
+ * @param len number of bytes
+*/
+static void rxSpiBlock(const uint8_t *bytes, uint16_t len)
+{
+    if (!rxReady())
+    {
+        return;
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        SyncRxDeframe(bytes[i]);
+        // Stop if the deframer reset sync, the rest of the block falls within the reset delay
+        if (syncRxTimer > 0)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief SPI RX DMA half complete callback, deframes the first half of the line byte buffer
+*/
+static void syncRxSpiHalfCplt(DMA_HandleTypeDef *hdma)
+{
+    rxSpiBlock(syncRxSpiBuf, SYNC_RX_SPI_BYTES / 2);
+    if (dmaOverrun(hdma, true)) { syncRxOverruns++; }
+}
+
+/**
+ * @brief SPI RX DMA complete callback, deframes the second half of the line byte buffer
+*/
+static void syncRxSpiCplt(DMA_HandleTypeDef *hdma)
+{
+    rxSpiBlock(syncRxSpiBuf + SYNC_RX_SPI_BYTES / 2, SYNC_RX_SPI_BYTES / 2);
+    if (dmaOverrun(hdma, false)) { syncRxOverruns++; }
+}
+
+/**
+ * @brief Set up SPI1 as a receive-only slave shifting RXD in on RXCLK, with circular DMA into syncRxSpiBuf
+ *
+ * With SPI1 remapped, SCK lands on PB3 (RXCLK) and a bidirectional-mode slave receives on MISO, which is PB4 (RXD).
+ * Both pins are left as GPIO inputs, since alternate function inputs are always connected on the F1. The SPI
+ * samples on the rising clock edge like the bit-banged path, and byte boundaries are arbitrary, which is fine
+ * because SyncRxDeframe() hunts for the flag bit by bit.
+*/
+static void rxSpiStart()
+{
+    __HAL_RCC_SPI1_CLK_ENABLE();
+    // The HAL remap macro writes all 1s to the SWJ config (disabling SWD), so keep JTAG-only disabled by hand
+    AFIO->MAPR = (AFIO->MAPR & ~AFIO_MAPR_SWJ_CFG) | AFIO_MAPR_SWJ_CFG_JTAGDISABLE | AFIO_MAPR_SPI1_REMAP;
+
+    /* SPI1_RX DMA Init */
+    hdma_spi1_rx.Instance = DMA1_Channel2;
+    hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_spi1_rx.Init.Mode = DMA_CIRCULAR;
+    hdma_spi1_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK)
+    {
+        Error_Handler();
     }
+    hdma_spi1_rx.XferHalfCpltCallback = syncRxSpiHalfCplt;
+    hdma_spi1_rx.XferCpltCallback = syncRxSpiCplt;
+    HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, NVIC_PRI_SYNC_RX_DMA, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+    HAL_DMA_Start_IT(&hdma_spi1_rx, (uint32_t)&SPI1->DR, (uint32_t)syncRxSpiBuf, SYNC_RX_SPI_BYTES);
+
+    // Slave, 1-line receive only, LSB first, CPOL 0 / CPHA 0, software NSS held low (SSI clear)
+    SPI1->CR2 = SPI_CR2_RXDMAEN;
+    SPI1->CR1 = SPI_CR1_BIDIMODE | SPI_CR1_LSBFIRST | SPI_CR1_SSM;
+    SPI1->CR1 |= SPI_CR1_SPE;
 }
 
+#endif
+
 /**
- * @brief Callback for the 9600 baud timer interrupt (actually runs at X2 speed), clocks data in & out
+ * @brief Callback for the line rate timer interrupt (actually runs at X2 speed), clocks data in & out
 */
 void SyncTimerCallback(void)
 {
+    // Schedule the period after this one
+    clkStep(&syncLineClk, 1);
     // We do serial stuff on the rising edge of the clock.
     if (falling)
     {
         falling = false;
+        // TX pins are driven by the waveform DMA in DMA mode
+        #ifndef SYNC_TX_DMA
         // Set clocks high before we do anything
         TXCLK_HIGH();
         // Set TX pins to their proper state
         SET_TXD(NextTxBit());
+        #endif
         //SET_CTS(cts);
-        // Read RX pins
+        // Read RX pins (handled by the DMA callbacks in DMA, SPI & oversampling modes)
+        #if !defined(SYNC_RX_DMA) && !defined(SYNC_RX_SPI) && !defined(SYNC_RX_OVERSAMPLE)
         RxBits();
+        #endif
     }
     // On the falling edge we do nothing
     else
     {
         falling = true;
         // Gate the TX & RX pins
+        #ifndef SYNC_TX_DMA
         TXCLK_LOW();
+        #endif
+    }
+    // The update flag is cleared before we're called, so if it's set again we've missed the start of the next period
+    if (__HAL_TIM_GET_FLAG(syncTim, TIM_FLAG_UPDATE))
+    {
+        syncTimerOverruns++;
+    }
+}
+
+#ifdef SYNC_RX_OVERSAMPLE
+
+/**
+ * @brief Run a block of oversampled RXD through the digital PLL, and deframe the bits sampled at each bit centre
+ *
+ * The phase advances by a bit every SYNC_RX_OVERSAMPLE samples, and the bit is sampled as it passes half way. A
+ * transition should land on phase 0, and since it happened somewhere between the last sample and this one, half a
+ * step back from here is taken as its phase. Each transition pulls the phase a fraction of the way towards it, and
+ * trims the step a little for the line's clock running fast or slow. Averaging over transitions like this keeps
+ * jittery edges from pushing the sample point around, and the frequency term keeps a steady skew from leaving it
+ * late or early between transitions (HDLC guarantees one at least every 6 bits).
+ *
+ * @param *samples pointer to the first sample
+ * @param len number of samples
+*/
+static void rxDpllBlock(const uint8_t *samples, uint16_t len)
+{
+    if (!rxReady())
+    {
+        return;
     }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uint8_t level = (samples[i] & DCE_RXD_Pin) != 0;
+        uint16_t step = SYNC_DPLL_STEP + dpllFreq;
+        uint16_t phase = dpllPhase + step;
+        if (level != dpllLast)
+        {
+            dpllLast = level;
+            syncDpllTransitions++;
+            // Positive means the transition came later than expected, so we're running ahead of the line
+            int32_t err = (int16_t)(phase - step / 2);
+            if (err > 0)
+            {
+                syncDpllAhead++;
+                syncDpllErrSum += ((uint32_t)err * SYNC_RX_OVERSAMPLE + 0x8000) >> 16;
+            }
+            else if (err < 0)
+            {
+                syncDpllBehind++;
+                syncDpllErrSum += ((uint32_t)-err * SYNC_RX_OVERSAMPLE + 0x8000) >> 16;
+            }
+            phase -= err / (1 << SYNC_DPLL_KP_SHIFT);
+            int32_t freq = dpllFreq - err / (1 << SYNC_DPLL_KI_SHIFT);
+            if (freq > SYNC_DPLL_FREQ_MAX) { freq = SYNC_DPLL_FREQ_MAX; }
+            if (freq < -SYNC_DPLL_FREQ_MAX) { freq = -SYNC_DPLL_FREQ_MAX; }
+            dpllFreq = freq;
+        }
+        // A new bit starts each time the phase wraps round (corrections only move it back within a bit)
+        if (phase < dpllPhase && (int16_t)(phase - dpllPhase) > 0)
+        {
+            dpllSampled = false;
+        }
+        dpllPhase = phase;
+        // Sample each bit once, at the sample nearest its centre (or straight away if a correction skipped past it)
+        if (!dpllSampled && phase >= 0x8000 - step / 2)
+        {
+            dpllSampled = true;
+            // Stop if the deframer reset sync, the rest of the block falls within the reset delay
+            if (rxPushBit(level) && syncRxTimer > 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Oversampled RX DMA half complete callback, processes the first half of the sample buffer
+*/
+static void syncRxOsHalfCplt(DMA_HandleTypeDef *hdma)
+{
+    rxDpllBlock(syncRxOsSamples, SYNC_RX_OS_SAMPLES / 2);
+    clkStep(&syncRxOsClk, SYNC_RX_OS_SAMPLES / 2);
+    if (dmaOverrun(hdma, true)) { syncRxOverruns++; }
 }
 
 /**
- * @brief Report the free space in the fifo, divided by the LDU frame size in bytes
+ * @brief Oversampled RX DMA complete callback, processes the second half of the sample buffer
 */
-uint8_t SyncGetTxFree()
+static void syncRxOsCplt(DMA_HandleTypeDef *hdma)
 {
-    uint16_t framesFree = (syncTxFifo.maxlen - syncTxFifo.size) / P25_V24_LDU_FRAME_LENGTH_BYTES;
-    // Reset buffers if we get low
-    if (framesFree < 1)
+    rxDpllBlock(syncRxOsSamples + SYNC_RX_OS_SAMPLES / 2, SYNC_RX_OS_SAMPLES / 2);
+    clkStep(&syncRxOsClk, SYNC_RX_OS_SAMPLES / 2);
+    if (dmaOverrun(hdma, false)) { syncRxOverruns++; }
+}
+
+/**
+ * @brief Start TIM3 at SYNC_RX_OVERSAMPLE times the line rate, with each update capturing the GPIO inputs by DMA
+*/
+static void rxOsStart()
+{
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    TIM3->PSC = 0;
+    TIM3->CR1 = TIM_CR1_ARPE;
+    clkConfigure(&syncRxOsClk, syncLineRate * SYNC_RX_OVERSAMPLE);
+    // Load the period, then clear the update flag so the first DMA request comes from a real update
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0;
+
+    /* TIM3_UP DMA Init */
+    hdma_tim3_up.Instance = DMA1_Channel3;
+    hdma_tim3_up.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_tim3_up.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_tim3_up.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_tim3_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_tim3_up.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_tim3_up.Init.Mode = DMA_CIRCULAR;
+    hdma_tim3_up.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    if (HAL_DMA_Init(&hdma_tim3_up) != HAL_OK)
     {
-        log_error("TX buffer low: %d / %d bytes used, resetting buffer", syncTxFifo.size, syncTxFifo.maxlen);
-        VCPWriteDebug3("TX buffer low, clearing. Bytes Free/Total: ", syncTxFifo.size, syncTxFifo.maxlen);
-        FifoClear(&syncTxFifo);
+        Error_Handler();
     }
-    return framesFree;
+    hdma_tim3_up.XferHalfCpltCallback = syncRxOsHalfCplt;
+    hdma_tim3_up.XferCpltCallback = syncRxOsCplt;
+    HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, NVIC_PRI_SYNC_RX_DMA, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+    HAL_DMA_Start_IT(&hdma_tim3_up, (uint32_t)&DCE_RXD_GPIO_Port->IDR, (uint32_t)syncRxOsSamples, SYNC_RX_OS_SAMPLES);
+
+    TIM3->DIER = TIM_DIER_UDE;
+    TIM3->CR1 |= TIM_CR1_CEN;
+}
+
+#endif
+
+#ifdef SYNC_EXT_CLOCK
+
+/**
+ * @brief Set up RXCLK to interrupt on both edges of the external clock (EXTI line 3)
+*/
+static void extClkStart()
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = DCE_RXCLK_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(DCE_RXCLK_GPIO_Port, &GPIO_InitStruct);
+    HAL_NVIC_SetPriority(EXTI3_IRQn, NVIC_PRI_SYNC_EXT_CLK, 0);
+    HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+}
+
+/**
+ * @brief Called on every edge of the external clock, clocks data in & out like SyncTimerCallback and repeats the clock on TXCLK
+*/
+void SyncClockEdge(void)
+{
+    uint16_t now = syncTim->Instance->CNT;
+    uint32_t tick = HAL_GetTick();
+    if (GET_RXCLK())
+    {
+        TXCLK_HIGH();
+        SET_TXD(NextTxBit());
+        #ifndef SYNC_RX_SPI
+        RxBits();
+        #endif
+        // Restart the rate measurement after a gap, since the timestamp wraps every 65536 ticks
+        if (tick - syncExtClkLastEdge > 1U)
+        {
+            syncExtClkTicks = 0;
+            syncExtClkPeriods = 0;
+        }
+        else
+        {
+            syncExtClkTicks += (uint16_t)(now - syncExtClkLastCapture);
+            syncExtClkPeriods++;
+            if (syncExtClkPeriods >= SYNC_EXT_CLK_AVG_BITS)
+            {
+                syncExtClkSum = syncExtClkTicks;
+                syncExtClkTicks = 0;
+                syncExtClkPeriods = 0;
+            }
+        }
+        syncExtClkLastCapture = now;
+    }
+    else
+    {
+        TXCLK_LOW();
+    }
+    syncExtClkLastEdge = tick;
+}
+
+#endif
+
+/**
+ * @brief Called from the main loop, watches the external clock (does nothing when we generate our own)
+*/
+void SyncClockCallback()
+{
+    #ifdef SYNC_EXT_CLOCK
+    bool lost = HAL_GetTick() - syncExtClkLastEdge > SYNC_EXT_CLK_TIMEOUT;
+    if (lost && !syncExtClkLost)
+    {
+        syncExtClkSum = 0;
+        log_warn("External clock lost");
+        VCPWriteDebug1("External clock lost");
+    }
+    else if (!lost && syncExtClkLost)
+    {
+        log_info("External clock detected");
+        VCPWriteDebug1("External clock detected");
+    }
+    syncExtClkLost = lost;
+    #endif
+}
+
+/**
+ * @brief Called from the main loop, does the logging and resets for events posted by the interrupt handlers
+*/
+void SyncEventCallback()
+{
+    while (syncEventTail != syncEventHead)
+    {
+        uint8_t tail = syncEventTail;
+        // Make sure we read the record after seeing the head that published it
+        __DMB();
+        SyncEvent_t evt = syncEvents[tail & (SYNC_EVENT_SLOTS - 1)];
+        // and that we're done reading it before the slot is handed back
+        __DMB();
+        syncEventTail = tail + 1;
+
+        switch (evt.code)
+        {
+            case SYNC_EVT_RX_START:
+                log_info("Sync RX starting");
+                VCPWriteDebug1("Sync RX starting");
+                break;
+            case SYNC_EVT_RX_SYNCED:
+                log_info("HDLC RX now synced");
+                VCPWriteDebug1("HDLC RX now synced");
+                break;
+            case SYNC_EVT_RX_ABORT:
+                log_error("Received 7 consecutive 1s, this is bad.");
+                VCPWriteDebug1("Received 7 consecutive 1s, this is bad.");
+                SyncReset();
+                break;
+            case SYNC_EVT_RX_BAD_STATE:
+                log_error("RX sync state machine got invalid state %lu", evt.arg);
+                VCPWriteDebug2("RX sync state machine got invalid state", (int16_t)evt.arg);
+                SyncReset();
+                break;
+            case SYNC_EVT_RX_NO_SLOT:
+                syncRxNoSlotPosted = false;
+                log_warn("No free RX frame slots! (%lu frames dropped so far)", syncRxFrameDrops);
+                break;
+            case SYNC_EVT_RX_TOO_LONG:
+                log_warn("RX message too long, dropping");
+                break;
+            default:
+                log_error("Unknown sync event %u", evt.code);
+                break;
+        }
+    }
+
+    // Report any events that didn't fit in the mailbox
+    uint32_t lost = syncEventsLost;
+    if (lost != syncEventsLostReported)
+    {
+        log_warn("Sync event mailbox full, %lu events lost", lost - syncEventsLostReported);
+        syncEventsLostReported = lost;
+    }
+}
+
+/**
+ * @brief Report the free space in the TX ring, in bits
+ * 
+ * Frames are only added when there's room for them, so the ring is never cleared to make space
+*/
+uint16_t SyncGetTxFreeBits()
+{
+    return txRingFree(syncTxHead);
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : txbuf.c
+  * @brief          : Pool of TX frame buffers with head room
+  *
+  * A frame is written into a pool buffer once, by whoever receives it, and the
+  * buffer is then passed along by pointer. The HDLC layer adds its address
+  * and control bytes in the reserved room in front of the payload instead of
+  * copying it into a bigger buffer. Buffers are only used from the main loop.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "txbuf.h"
+
+#include "log.h"
+
+// A buffer must have room for some payload after the head room
+_Static_assert(TXBUF_SIZE > TXBUF_HEADROOM, "TXBUF_SIZE must be larger than TXBUF_HEADROOM");
+
+// Buffer pool
+TxBuf_t txBufPool[TXBUF_COUNT];
+
+/**
+ * @brief Get a free buffer from the pool, with an empty frame that has all the head room in front of it
+ * @return the buffer, or NULL if the pool is empty
+*/
+TxBuf_t *TxBufAlloc()
+{
+    for (uint8_t i = 0; i < TXBUF_COUNT; i++)
+    {
+        if (!txBufPool[i].used)
+        {
+            TxBuf_t *buf = &txBufPool[i];
+            buf->used = true;
+            buf->start = TXBUF_HEADROOM;
+            buf->len = 0;
+            return buf;
+        }
+    }
+    log_error("TX buffer pool empty!");
+    return NULL;
+}
+
+/**
+ * @brief Return a buffer to the pool
+ * @param *buf buffer to free
+*/
+void TxBufFree(TxBuf_t *buf)
+{
+    buf->used = false;
+}
+
+/**
+ * @brief Grow the frame into the head room
+ * @param *buf buffer
+ * @param n number of bytes to add in front of the frame
+ * @return pointer to the new first byte, or NULL if there's not enough head room
+*/
+uint8_t *TxBufPrepend(TxBuf_t *buf, uint16_t n)
+{
+    if (n > buf->start)
+    {
+        return NULL;
+    }
+    buf->start -= n;
+    buf->len += n;
+    return &buf->data[buf->start];
+}
+
+/**
+ * @brief Grow the frame at its end
+ * @param *buf buffer
+ * @param n number of bytes to add after the frame
+ * @return pointer to the first added byte, or NULL if there's not enough room
+*/
+uint8_t *TxBufAppend(TxBuf_t *buf, uint16_t n)
+{
+    if ((uint32_t)buf->start + buf->len + n > TXBUF_SIZE)
+    {
+        return NULL;
+    }
+    uint8_t *end = &buf->data[buf->start + buf->len];
+    buf->len += n;
+    return end;
+}
@@ -0,0 +1,229 @@
+/**
+  ******************************************************************************
+  * @file           : txq.c
+  * @brief          : Class based queueing of UI frames for the sync TX ring
+  *
+  * UI payloads from the host are classified by their first byte. Voice
+  * streams (IMBE records, with the start/end and header records around them
+  * so they stay in order) go to the jitter buffer and always go first. TSBKs
+  * and other data each have their own queue, and share what's left of the
+  * line by weighted round robin (TXQ_WEIGHT_TSBK to TXQ_WEIGHT_DATA frames).
+  * Data frames only go into the sync TX ring while it's nearly empty, so
+  * voice never waits behind more than one of them. If a data queue is full
+  * while a voice stream is running, the frame is dropped rather than holding
+  * up the VCP parser (and the voice behind it), otherwise it's held there as
+  * before. Only used from the main loop.
+  ******************************************************************************
+  */
+
+// self-referential include
+#include "txq.h"
+
+#include "hdlc.h"
+#include "jitter.h"
+#include "log.h"
+#include "ring.h"
+#include "sync.h"
+
+_Static_assert((TXQ_TSBK_BUF_LEN & (TXQ_TSBK_BUF_LEN - 1)) == 0, "TXQ_TSBK_BUF_LEN must be a power of 2");
+_Static_assert((TXQ_DATA_BUF_LEN & (TXQ_DATA_BUF_LEN - 1)) == 0, "TXQ_DATA_BUF_LEN must be a power of 2");
+// A data frame of the largest size has to fit, with its length
+_Static_assert(TXQ_DATA_BUF_LEN >= TXBUF_SIZE + 2U, "TXQ_DATA_BUF_LEN too small for TXBUF_SIZE");
+_Static_assert(TXQ_WEIGHT_TSBK >= 1U && TXQ_WEIGHT_DATA >= 1U, "TXQ_WEIGHT_TSBK and TXQ_WEIGHT_DATA must be at least 1");
+
+/**
+ * A queue of frames, each a 16 bit big-endian payload length followed by the payload
+*/
+typedef struct {
+    Ring_t ring;
+    uint8_t frames;     // number of frames queued
+    uint8_t weight;     // frames sent per turn
+} TxQueue_t;
+
+// The TSBK & data classes have a queue each
+#define TXQ_QUEUES  (TXQ_CLASSES - TXQ_TSBK)
+
+// Queued frames for the TSBK & data classes
+uint8_t txqTsbkBuf[TXQ_TSBK_BUF_LEN];
+uint8_t txqDataBuf[TXQ_DATA_BUF_LEN];
+TxQueue_t txqQueues[TXQ_QUEUES] = {
+    { .ring = RING_INIT(txqTsbkBuf), .frames = 0, .weight = TXQ_WEIGHT_TSBK },
+    { .ring = RING_INIT(txqDataBuf), .frames = 0, .weight = TXQ_WEIGHT_DATA },
+};
+
+// Queue whose turn it is, and the frames it's sent this turn
+uint8_t txqTurn = 0;
+uint8_t txqBurst = 0;
+
+// Frames accepted and dropped per class
+uint32_t txqQueued[TXQ_CLASSES];
+uint32_t txqDrops[TXQ_CLASSES];
+
+/**
+ * @brief Get the queue for the TSBK or data class
+*/
+static inline TxQueue_t *txqQueue(uint8_t cls)
+{
+    return &txqQueues[cls - TXQ_TSBK];
+}
+
+/**
+ * @brief Drop all the queued frames (the statistics are kept)
+*/
+void TxqReset()
+{
+    for (uint8_t i = 0; i < TXQ_QUEUES; i++)
+    {
+        RingClear(&txqQueues[i].ring);
+        txqQueues[i].frames = 0;
+    }
+    txqTurn = 0;
+    txqBurst = 0;
+    #ifdef TX_JITTER
+    JitterReset();
+    #endif
+}
+
+/**
+ * @brief Queue a UI payload by its class
+ *
+ * @param buf TX buffer holding the UI payload
+ * @return true if the buffer was taken (queued, sent or dropped), false if the caller has to hold onto it
+*/
+bool TxqPut(TxBuf_t *buf)
+{
+    uint8_t cls = TxqClassify(TxBufData(buf)[0]);
+    if (cls == TXQ_VOICE || cls == TXQ_STREAM)
+    {
+        #ifdef TX_JITTER
+        if (!JitterPut(buf))
+        {
+            return false;
+        }
+        #else
+        if (buf->len > HDLCGetUIRoom())
+        {
+            return false;
+        }
+        HDLCSendUIBuf(buf);
+        #endif
+        txqQueued[cls]++;
+        return true;
+    }
+    TxQueue_t *q = txqQueue(cls);
+    if (RingFree(&q->ring) < buf->len + 2U || q->frames == 0xFFU)
+    {
+        #ifdef TX_JITTER
+        // Holding this one up would hold up the voice behind it in the RX ring too
+        if (JitterActive())
+        {
+            txqDrops[cls]++;
+            TxBufFree(buf);
+            return true;
+        }
+        #endif
+        return false;
+    }
+    const uint8_t hdr[2] = { (buf->len >> 8) & 0xFFU, buf->len & 0xFFU };
+    RingWrite(&q->ring, hdr, 2U);
+    RingWrite(&q->ring, TxBufData(buf), buf->len);
+    q->frames++;
+    txqQueued[cls]++;
+    TxBufFree(buf);
+    return true;
+}
+
+/**
+ * @brief Pick the data queue to send from next, by weighted round robin
+ * @return the queue, or NULL if they're all empty
+*/
+static TxQueue_t *txqPick()
+{
+    // Going round once more than there are queues gets back to a queue that used up its turn while the others were empty
+    for (uint8_t n = 0; n <= TXQ_QUEUES; n++)
+    {
+        TxQueue_t *q = &txqQueues[txqTurn];
+        if (q->frames > 0 && txqBurst < q->weight)
+        {
+            return q;
+        }
+        txqTurn = (txqTurn + 1U) % TXQ_QUEUES;
+        txqBurst = 0;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Called during the main loop to move queued frames on to the HDLC layer, voice first
+*/
+void TxqCallback()
+{
+    #ifdef TX_JITTER
+    JitterCallback();
+    #endif
+
+    TxQueue_t *q;
+    while ((q = txqPick()) != NULL)
+    {
+        // Wait until the sync TX ring has nearly drained, so the next voice frame isn't stuck behind a backlog of data
+        if (SYNC_TX_RING_BITS - 1U - SyncGetTxFreeBits() >= TXQ_DATA_BACKLOG_BITS)
+        {
+            return;
+        }
+        uint8_t hi, lo;
+        RingPeek(&q->ring, 0U, &hi);
+        RingPeek(&q->ring, 1U, &lo);
+        uint16_t len = ((uint16_t)hi << 8) | lo;
+        if (len > HDLCGetUIRoom())
+        {
+            return;
+        }
+        TxBuf_t *buf = TxBufAlloc();
+        if (buf == NULL)
+        {
+            return;
+        }
+        RingReadCommit(&q->ring, 2U);
+        RingRead(&q->ring, TxBufAppend(buf, len), len);
+        q->frames--;
+        txqBurst++;
+        HDLCSendUIBuf(buf);
+    }
+}
+
+/**
+ * @brief Get the number of frames of a class waiting to be sent
+*/
+uint8_t TxqGetDepth(uint8_t cls)
+{
+    switch (cls)
+    {
+        #ifdef TX_JITTER
+        case TXQ_VOICE:
+            return JitterGetVoice();
+        case TXQ_STREAM:
+            return JitterGetFrames() - JitterGetVoice();
+        #endif
+        case TXQ_TSBK:
+        case TXQ_DATA:
+            return txqQueue(cls)->frames;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Get the number of bytes queued in all the classes, for the host credit
+*/
+uint16_t TxqGetUsed()
+{
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < TXQ_QUEUES; i++)
+    {
+        used += RingUsed(&txqQueues[i].ring);
+    }
+    #ifdef TX_JITTER
+    used += JitterGetUsed();
+    #endif
+    return used;
+}
@@ -8,6 +8,8 @@
 /* Self referential incude */
 #include "util.h"
 #include <inttypes.h>
+#include "crc.h"
+#include "hdlc.h"
 
 /**
  * @brief Converts an array of chars to a space-separated string with braces
@@ -15,10 +17,10 @@
  * @param *array pointer to array to print
  * @param len length of array
  */
-void HexArrayToStr(char *buf, uint8_t *array, uint8_t len)
+void HexArrayToStr(char *buf, uint8_t *array, uint16_t len)
 {
     sprintf(buf, "{ ");
-    for (uint8_t i = 0; i < len; i++)
+    for (uint16_t i = 0; i < len; i++)
     {
         sprintf(buf + strlen(buf), "%02X ", array[i]);
     }
@@ -55,9 +57,9 @@ uint8_t SetBitAtPos(uint8_t byte, uint8_t pos, bool value)
  * @param array input array to print
  * @param len length of array
  */
-void printHexArray(char *outBuf, uint8_t *array, uint8_t len)
+void printHexArray(char *outBuf, uint8_t *array, uint16_t len)
 {
-    for (uint8_t i = 0; i < len; i++)
+    for (uint16_t i = 0; i < len; i++)
     {
         sprintf(outBuf + (i * 3), " %02X", array[i]);
     }
@@ -109,4 +111,92 @@ void getUidString(char *str)
 uint16_t readFlashSize()
 {
     return (uint16_t)(0x1FF8007C);
-}
\ No newline at end of file
+}
+
+#ifdef ISR_CYCLE_STATS
+
+// Worst case cycles spent in each tracked interrupt handler since startup
+volatile uint32_t isrCyclesMax[ISR_CYC_COUNT];
+
+static const char *isrCycleNames[ISR_CYC_COUNT] = {
+    "TIM2", "EXTI3", "USART1", "USART2", "Sync TX DMA", "Sync RX DMA"
+};
+
+#endif
+
+/**
+ * @brief Start the DWT cycle counter used to time interrupt handlers (does nothing without ISR_CYCLE_STATS)
+ */
+void IsrCyclesInit()
+{
+    #ifdef ISR_CYCLE_STATS
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+}
+
+/**
+ * @brief Log the worst case cycles of each interrupt handler that has run (does nothing without ISR_CYCLE_STATS)
+ *
+ * Counts are from handler entry to exit, so add ~12 cycles of exception entry and ~10 of exit on top
+ *
+ * @param tim2Budget CPU cycles between TIM2 updates at the current line rate
+ */
+void IsrCyclesLog(uint32_t tim2Budget)
+{
+    #ifdef ISR_CYCLE_STATS
+    for (uint8_t i = 0; i < ISR_CYC_COUNT; i++)
+    {
+        if (isrCyclesMax[i] == 0)
+        {
+            continue;
+        }
+        if (i == ISR_CYC_TIM2)
+        {
+            log_info("ISR worst case %s: %lu cycles (budget %lu)", isrCycleNames[i], isrCyclesMax[i], tim2Budget);
+        }
+        else
+        {
+            log_info("ISR worst case %s: %lu cycles", isrCycleNames[i], isrCyclesMax[i]);
+        }
+    }
+    #else
+    (void)tim2Budget;
+    #endif
+}
+
+#ifdef CRC_BENCHMARK
+static uint32_t crcBenchCycles()
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+/**
+ * @brief Time each CRC kernel over a full size frame and log the results (does nothing without CRC_BENCHMARK)
+ *
+ * Must be called after CrcInit
+ */
+void CrcBenchmarkLog()
+{
+    #ifdef CRC_BENCHMARK
+    static uint8_t frame[HDLC_MAX_FRAME_SIZE_BYTES];
+    for (uint16_t i = 0; i < sizeof(frame); i++)
+    {
+        frame[i] = (uint8_t)(i * 7 + 0x5A);
+    }
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    for (uint8_t k = 0; k < CRC_KERNEL_COUNT; k++)
+    {
+        uint32_t cycles = CrcBenchmark(k, frame, sizeof(frame), crcBenchCycles);
+        if (cycles == 0)
+        {
+            log_error("CRC %s kernel gave the wrong result!", crcKernelNames[k]);
+            continue;
+        }
+        log_info("CRC %s kernel: %lu cycles for %u bytes%s", crcKernelNames[k], cycles, (unsigned)sizeof(frame), k == CRC_KERNEL ? " (selected)" : "");
+    }
+    #endif
+}
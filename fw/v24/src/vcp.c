@@ -11,11 +11,14 @@
 #include "leds.h"
 #include "stdio.h"
 #include "log.h"
-#include "fifo.h"
+#include "ring.h"
 #include "util.h"
 #include "config.h"
 #include "string.h"
 #include "hdlc.h"
+#include "txbuf.h"
+#include "jitter.h"
+#include "txq.h"
 #include "main.h"
 
 #ifdef DVM_V24_V1
@@ -40,54 +43,89 @@ bool vcpRxDoubleLength = false;
 // Buffer for storing received message
 uint8_t vcpRxMsg[VCP_MAX_MSG_LENGTH_BYTES];
 
+// TX buffer the payload of a P25 data message is written into as it's received
+TxBuf_t *vcpRxFrame = NULL;
+
+// Received P25 frame waiting for room in the sync TX ring, nothing more is parsed until it's gone
+TxBuf_t *vcpRxHeld = NULL;
+
+#ifdef STATUS_PUSH
+// Set once we've told the host space is below STATUS_PUSH_LOW, until it's back up to STATUS_PUSH_HIGH
+bool vcpStatusLow = false;
+#endif
+
 // Expected total message length
 uint16_t vcpRxMsgLength = 0U;
 
 // Current message length
 uint16_t vcpRxMsgPosition = 0U;
 
-// VCP RX Fifo
+// VCP RX ring, filled by the USB/USART1 interrupts and read by the main loop
 uint8_t vcpRxBuf[VCP_RX_BUF_LEN];
-FIFO_t vcpRxFifo = {
-    .buffer = vcpRxBuf,
-    .head = 0,
-    .tail = 0,
-    .maxlen = VCP_RX_BUF_LEN
-};
-
-// Buffer for tx message
-uint8_t txBuffer[VCP_MAX_MSG_LENGTH_BYTES];
-// TX message position/length
-uint16_t txPos = 0U;
-
-// VCP RX FIFO
+Ring_t vcpRxFifo = RING_INIT(vcpRxBuf);
+
+// Set from interrupt context when the RX ring overflows or the UART errors, the main loop then flushes the ring & parser
+volatile bool vcpRxFlush = false;
+
+_Static_assert((VCP_RX_BUF_LEN & (VCP_RX_BUF_LEN - 1)) == 0, "VCP_RX_BUF_LEN must be a power of 2");
+_Static_assert((VCP_TX_BUF_LEN & (VCP_TX_BUF_LEN - 1)) == 0, "VCP_TX_BUF_LEN must be a power of 2");
+// A whole message of the largest size has to fit in each of the rings
+_Static_assert(VCP_RX_BUF_LEN >= VCP_MAX_MSG_LENGTH_BYTES, "VCP_RX_BUF_LEN too small for VCP_MAX_MSG_LENGTH_BYTES");
+_Static_assert(VCP_TX_BUF_LEN >= VCP_MAX_MSG_LENGTH_BYTES, "VCP_TX_BUF_LEN too small for VCP_MAX_MSG_LENGTH_BYTES");
+// Message lengths are at most 16 bit
+_Static_assert(VCP_MAX_MSG_LENGTH_BYTES <= 0xFFFFU, "VCP_MAX_MSG_LENGTH_BYTES too large");
+
+// VCP TX ring, written and read by the main loop
 uint8_t vcpTxBuf[VCP_TX_BUF_LEN];
-FIFO_t vcpTxFifo = {
-    .buffer = vcpTxBuf,
-    .head = 0,
-    .tail = 0,
-    .maxlen = VCP_TX_BUF_LEN
-};
+Ring_t vcpTxFifo = RING_INIT(vcpTxBuf);
+
+#ifdef DVM_V24_V1
+// Bytes of the TX ring the running USB IN transfer is sending straight out of, 0 when the endpoint is idle
+volatile uint16_t vcpUsbTxBytes = 0U;
+// Set when the OUT endpoint has been left NAKing because the RX ring can't take another packet
+volatile bool vcpUsbRxPaused = false;
+#endif
 
 // Vars for V2 serial implementation
 #ifndef DVM_V24_V1
-bool usartRx = false;
-bool usartTx = false;
-unsigned long usartTxStart = 0;
-uint8_t usartRxBuffer = 0;
+volatile bool usartRx = false;
+// USART1 TX is double buffered, the main loop packs whole messages into one buffer while DMA sends the other
+uint8_t vcpTxDmaBuf[2][VCP_MAX_MSG_LENGTH_BYTES];
+// Bytes waiting in each buffer, 0 once it's free again. Set by the main loop, cleared by the TX complete interrupt
+volatile uint16_t vcpTxDmaLen[2] = { 0U, 0U };
+// Buffer the main loop packs next
+uint8_t vcpTxFill = 0U;
+// Buffer being sent, or sent next. Only moved by the TX complete interrupt
+volatile uint8_t vcpTxSend = 0U;
+// Set while a transfer is running, the TX complete interrupt owns the buffers until it's cleared
+volatile bool usartTx = false;
+volatile unsigned long usartTxStart = 0;
+// Time taken by the last transfer that went over VCP_TX_TIMEOUT, logged by the main loop
+volatile unsigned long vcpTxSlowMs = 0;
+// Last UART error code, logged by the main loop
+volatile uint32_t vcpRxUartError = 0;
+#ifdef VCP_HW_FLOW_CONTROL
+// Set when RX DMA has been held off because the ring is filling up, RTS then holds off the host
+volatile bool vcpRxPaused = false;
+#endif
+// Current host link baud rate
+uint32_t vcpBaud = VCP_BAUD_DEFAULT;
+// Rate the host has asked for, applied once everything up to & including the ACK has gone out at the old rate
+uint32_t vcpBaudPending = 0U;
+// TX ring position just past that ACK
+uint16_t vcpBaudSwitchMark = 0U;
+// Time of the last complete message from the host, for falling back to the default rate
+unsigned long vcpBaudLastRx = 0;
 #endif
 
 /**
- * @brief Clear the RX buffers related to the VCP RX routines
+ * @brief Clear the RX buffers related to the VCP RX routines (main loop only, the interrupts set vcpRxFlush instead)
  * 
  */
 void vcpRxClearBuffer()
 {
-    // Clear FIFO
-    FifoClear(&vcpRxFifo);
-    #ifndef DVM_V24_V1
-    usartRxBuffer = 0x00U;
-    #endif
+    // Clear ring
+    RingClear(&vcpRxFifo);
 }
 
 /**
@@ -95,6 +133,12 @@ void vcpRxClearBuffer()
 */
 void vcpRxReset()
 {
+    // Give back the TX buffer of a P25 message that wasn't finished
+    if (vcpRxFrame != NULL)
+    {
+        TxBufFree(vcpRxFrame);
+        vcpRxFrame = NULL;
+    }
     vcpRxMsgInProgress = false;
     vcpRxDoubleLength = false;
     vcpRxMsgLength = 0U;
@@ -104,27 +148,27 @@ void vcpRxReset()
 #ifdef DVM_V24_V1
 
 /**
- * @brief Called by the CDC_Receive_FS interrupt callback and fills the FIFO with the received bytes
+ * @brief Called by the CDC_Receive_FS interrupt callback and fills the ring with the received bytes
+ * @return true if the OUT endpoint can be re-armed straight away, false to leave it for the main loop
 */
-void VCPRxITCallback(uint8_t* buf, uint32_t len)
+bool VCPRxITCallback(uint8_t* buf, uint32_t len)
 {
-    uint32_t start = HAL_GetTick();
-    for (uint32_t i = 0; i < len; i++)
-    {
-        if (FifoPush(&vcpRxFifo, buf[i]))
-        {
-            log_error("VCP RX FIFO full! Clearing buffer");
-            // Clear
-            vcpRxClearBuffer();
-        }
-    }
-    if (HAL_GetTick() - start > FUNC_TIMER_WARN)
+    // A USB packet is at most 64 bytes and we only take one when there's room for it, so this shouldn't fail
+    if (!RingWrite(&vcpRxFifo, buf, (uint16_t)len))
     {
-        log_warn("VCPRxITCallback took %u ms!", HAL_GetTick() - start);
+        vcpRxFlush = true;
     }
     #ifdef TRACE_VCP_RX
-    log_debug("Added %u bytes to VCP RX FIFO", len);
+    log_debug("Added %u bytes to VCP RX ring", len);
     #endif
+    // Without room for another packet the OUT endpoint is left NAKing, which holds off the host until the main loop
+    // has read enough to re-arm it
+    if (RingFree(&vcpRxFifo) < CDC_DATA_FS_MAX_PACKET_SIZE)
+    {
+        vcpUsbRxPaused = true;
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -137,29 +181,126 @@ void VCPEnumerate()
     USB_ENUM(1);
 }
 
+/**
+ * @brief Start a USB IN transfer of whatever's at the front of the TX ring (from the USB interrupt, or with it masked)
+ * @return true if a transfer started
+ */
+static bool vcpUsbTxStart()
+{
+    uint8_t *span;
+    uint16_t len = RingReadSpan(&vcpTxFifo, &span);
+    if (len == 0U || CDC_Transmit_FS(span, len) != USBD_OK)
+    {
+        return false;
+    }
+    vcpUsbTxBytes = len;
+    LED_USB(1);
+    return true;
+}
+
+/**
+ * @brief Called by the CDC transmit complete callback once a whole transfer has gone to the host
+ * 
+ * The CDC class splits a transfer into 64-byte packets and ends one that's a multiple of 64 bytes with a zero length
+ * packet before calling back, so the host always sees where it stops. This releases the bytes just sent and starts
+ * on the next lot straight away, so the IN endpoint runs as fast as the host polls it, not once per main loop pass.
+ */
+void VCPUsbTxComplete()
+{
+    RingReadCommit(&vcpTxFifo, vcpUsbTxBytes);
+    vcpUsbTxBytes = 0U;
+    if (!vcpUsbTxStart())
+    {
+        LED_USB(0);
+    }
+}
+
+/**
+ * @brief Called when the CDC interface is (re)initialised
+ * 
+ * A running IN transfer will never complete so it's dropped, and the class has re-armed the OUT endpoint itself
+ */
+void VCPUsbReset()
+{
+    vcpUsbRxPaused = false;
+    if (vcpUsbTxBytes > 0U)
+    {
+        RingReadCommit(&vcpTxFifo, vcpUsbTxBytes);
+        vcpUsbTxBytes = 0U;
+        LED_USB(0);
+    }
+}
+
 #else
 
 /**
- * @brief Interrupt handler for USART1 RX
+ * @brief (Re)start USART1 reception, as circular DMA straight into the RX ring
+ *
+ * The DMA is the ring's producer. Its half & full transfer interrupts and the USART IDLE line interrupt report how far
+ * it's got, so there's an interrupt per burst from the host instead of one per byte.
+ */
+void vcpRxStartDma()
+{
+    HAL_UART_AbortReceive(&huart1);
+    RingReset(&vcpRxFifo);
+    #ifdef VCP_HW_FLOW_CONTROL
+    vcpRxPaused = false;
+    #endif
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart1, vcpRxBuf, VCP_RX_BUF_LEN);
+}
+
+/**
+ * @brief Change the host link baud rate
+ * 
+ * Only call this with USART1 TX idle, anything part way through being received is dropped
+ * 
+ * @param baud new rate
+ */
+static void vcpSetBaud(uint32_t baud)
+{
+    HAL_UART_AbortReceive(&huart1);
+    // The UART is already set up, so this only reprograms it (the MSP init isn't run again)
+    huart1.Init.BaudRate = baud;
+    if (HAL_UART_Init(&huart1) != HAL_OK)
+    {
+        log_error("Failed to set USART1 to %lu baud", baud);
+    }
+    vcpBaud = baud;
+    vcpBaudLastRx = HAL_GetTick();
+    // Have the main loop flush the parser & restart reception at the new rate
+    vcpRxFlush = true;
+    usartRx = false;
+}
+
+/**
+ * @brief USART1 RX DMA half/full transfer or IDLE line event
  * 
- * @param huart uart to handle (should be usart1)
+ * @param huart uart the event is for
+ * @param pos position in the DMA buffer the DMA has written up to
  */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t pos)
 {
-    uint32_t start = HAL_GetTick();
-    // Add received byte to the fifo
-    if (FifoPush(&vcpRxFifo, usartRxBuffer))
+    if (huart->Instance != USART1)
     {
-        log_error("VCP RX FIFO full! Clearing buffer");
-        FifoClear(&vcpRxFifo);
+        return;
     }
-    // Check how long this took
-    if (HAL_GetTick() - start > FUNC_TIMER_WARN)
+    // Publish everything the DMA wrote since the last event (a full transfer reports the buffer length, i.e. position 0)
+    uint16_t count = (pos - vcpRxFifo.head) & (VCP_RX_BUF_LEN - 1);
+    // If that's more than was free, the DMA has written over bytes the main loop hadn't read yet
+    if (count > RingFree(&vcpRxFifo))
     {
-        log_warn("HAL_UART_RxCpltCallback took %u ms!", HAL_GetTick() - start);
+        vcpRxFlush = true;
     }
-    // Call the interrupt again
-    HAL_UART_Receive_IT(huart, &usartRxBuffer, 1);
+    RingWriteCommit(&vcpRxFifo, count);
+    #ifdef VCP_HW_FLOW_CONTROL
+    // The DMA can write up to half the buffer before the next event, so stop taking bytes from the USART before
+    // there's less than that free. RTS then holds off the CP2102 until the main loop has made room
+    if (RingFree(&vcpRxFifo) < VCP_RX_BUF_LEN / 2U)
+    {
+        vcpRxPaused = true;
+        ATOMIC_CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+    }
+    #endif
 }
 
 /**
@@ -169,35 +310,173 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
  */
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
 {
-    log_error("Got UART error: %02X", huart->ErrorCode);
-    VCPWriteDebug2("Got HAL UART error code ", huart->ErrorCode);
-    vcpRxReset();
-    vcpRxClearBuffer();
+    // The parser & ring belong to the main loop, so have it log the error, reset them and restart reception
+    vcpRxUartError = huart->ErrorCode;
+    vcpRxFlush = true;
+    usartRx = false;
+}
+
+/**
+ * @brief Start a USART1 DMA transfer of the buffer that's next to send
+ * @return true if the transfer started
+ */
+static bool vcpTxStartDma()
+{
+    uint8_t idx = vcpTxSend;
+    usartTxStart = HAL_GetTick();
+    return HAL_UART_Transmit_DMA(&huart1, vcpTxDmaBuf[idx], vcpTxDmaLen[idx]) == HAL_OK;
 }
 
 /**
  * @brief Called by the HAL_UART_TxCpltCallback in serial.c
+ * 
+ * Frees the buffer that was just sent and starts on the other one straight away if the main loop has filled it,
+ * so the link doesn't sit idle until the next pass of the main loop
  */
 void VCPTxComplete()
 {
-    // Check for excessive delay
+    // Check for excessive delay (logged by the main loop, logging isn't safe from here)
     unsigned long txTime = HAL_GetTick() - usartTxStart;
     if (txTime > VCP_TX_TIMEOUT)
     {
-        log_error("VCP USART TX routine took %u ms!", txTime);
-        VCPWriteDebug1("VCP USART TX routine took > " STR(VCP_TX_TIMEOUT) "ms");
+        vcpTxSlowMs = txTime;
     }
-    // Reset buffer & position
-    memset(txBuffer, 0x00U, VCP_MAX_MSG_LENGTH_BYTES);
-    txPos = 0;
-    // Reset LED
+    // Hand the buffer back to the main loop and move on to the other one
+    vcpTxDmaLen[vcpTxSend] = 0U;
+    vcpTxSend ^= 1U;
+    if (vcpTxDmaLen[vcpTxSend] > 0U && vcpTxStartDma())
+    {
+        return;
+    }
+    // Nothing waiting (or the transfer didn't start, the main loop will try it again)
     LED_USB_TX(0);
-    // Reset flag
     usartTx = false;
 }
 
+/**
+ * @brief Move as many whole messages from the VCP TX ring into a DMA buffer as will fit
+ * 
+ * Messages only ever go into the ring whole, so it always starts with a DVM frame header
+ * 
+ * @param *buf buffer to fill
+ * @param max most bytes to pack (message boundaries always line up with this)
+ * @return number of bytes packed
+ */
+static uint16_t vcpTxPack(uint8_t *buf, uint16_t max)
+{
+    uint16_t len = 0U;
+    uint8_t start;
+    while (RingPeek(&vcpTxFifo, 0U, &start))
+    {
+        // Get the message length from its header
+        uint16_t msgLen = 0U;
+        uint8_t hi, lo;
+        if (start == DVM_SHORT_FRAME_START && RingPeek(&vcpTxFifo, 1U, &lo))
+        {
+            msgLen = lo;
+        }
+        else if (start == DVM_LONG_FRAME_START && RingPeek(&vcpTxFifo, 1U, &hi) && RingPeek(&vcpTxFifo, 2U, &lo))
+        {
+            msgLen = ((uint16_t)hi << 8) | lo;
+        }
+        // A bad header means we've lost our place, so there's no telling where the next message starts
+        if (msgLen < 2U || msgLen > RingUsed(&vcpTxFifo) || msgLen > VCP_MAX_MSG_LENGTH_BYTES)
+        {
+            log_error("Bad message in VCP TX ring (start %02X, len %u), dropping %u bytes", start, msgLen, RingUsed(&vcpTxFifo));
+            RingClear(&vcpTxFifo);
+            break;
+        }
+        // Leave the rest for the next buffer
+        if (msgLen > max - len)
+        {
+            break;
+        }
+        len += RingRead(&vcpTxFifo, buf + len, msgLen);
+    }
+    return len;
+}
+
 #endif
 
+/**
+ * @brief Queue the P25 frame held back for lack of room in its TX queue, if there's room for it now
+ * 
+ * Holding it up stops the parser, so the backlog stays in the RX ring (where flow control can hold off the host)
+ * rather than frames being dropped
+ * 
+ * @return true if nothing is held back any more
+*/
+static bool vcpRxSendHeld()
+{
+    if (vcpRxHeld == NULL)
+    {
+        return true;
+    }
+    if (!TxqPut(vcpRxHeld))
+    {
+        return false;
+    }
+    vcpRxHeld = NULL;
+    return true;
+}
+
+/**
+ * @brief Work out how many more bytes the host can send us right now
+ * 
+ * Everything the host sends ends up in the sync TX ring, which only drains at the V24 line rate, so that's the real
+ * limit. The credit is what that ring can still take after the backlog already waiting in front of it, and never
+ * more than the RX ring can hold, so the host can keep the line busy without anything overflowing or being flushed.
+ * 
+ * @return credit in bytes
+*/
+static uint16_t vcpRxCredit()
+{
+    uint16_t backlog = RingUsed(&vcpRxFifo);
+    if (vcpRxHeld != NULL)
+    {
+        backlog += vcpRxHeld->len;
+    }
+    backlog += TxqGetUsed();
+    uint16_t room = HDLCGetUIRoom();
+    uint16_t credit = room > backlog ? (uint16_t)(room - backlog) : 0U;
+    uint16_t rxFree = RingFree(&vcpRxFifo);
+    return credit < rxFree ? credit : rxFree;
+}
+
+/**
+ * @brief Get the credit in the units the status message reports it in
+*/
+static uint8_t vcpStatusSpace()
+{
+    #ifdef STATUS_SPACE_BLOCKS
+    uint16_t space = vcpRxCredit() / 16U;
+    #else
+    uint16_t space = vcpRxCredit() / P25_V24_LDU_FRAME_LENGTH_BYTES;
+    #endif
+    return space > 0xFFU ? 0xFFU : (uint8_t)space;
+}
+
+/**
+ * @brief Called during the main loop to push a status message to the host when the space we report crosses the
+ * STATUS_PUSH_LOW/STATUS_PUSH_HIGH thresholds
+*/
+void VCPStatusCallback()
+{
+    #ifdef STATUS_PUSH
+    uint8_t space = vcpStatusSpace();
+    if (!vcpStatusLow && space < STATUS_PUSH_LOW)
+    {
+        vcpStatusLow = true;
+        sendStatus();
+    }
+    else if (vcpStatusLow && space >= STATUS_PUSH_HIGH)
+    {
+        vcpStatusLow = false;
+        sendStatus();
+    }
+    #endif
+}
+
 /**
  * @brief Called during main loop to handle any data received from USB
 */
@@ -209,27 +488,45 @@ void VCPRxCallback()
     
     */
 
+    uint32_t start = HAL_GetTick();
+
+    // Drop everything if the interrupts overflowed the ring or hit a UART error
+    if (vcpRxFlush)
+    {
+        vcpRxFlush = false;
+        #ifndef DVM_V24_V1
+        if (vcpRxUartError)
+        {
+            log_error("Got UART error: %02X", vcpRxUartError);
+            VCPWriteDebug2("Got HAL UART error code ", vcpRxUartError);
+            vcpRxUartError = 0;
+        }
+        #endif
+        log_error("VCP RX ring overflow or error! Clearing buffer");
+        vcpRxReset();
+        vcpRxClearBuffer();
+    }
+
     #ifndef DVM_V24_V1
     if (!usartRx)
     {
-        HAL_UART_Receive_IT(&huart1, &usartRxBuffer, 1);
         usartRx = true;
-        log_info("Started USART1 RX IT transfer");
+        vcpRxStartDma();
+        log_info("Started USART1 RX DMA transfer");
     }
     #endif
 
-
-    uint32_t start = HAL_GetTick();
-
-    if (vcpRxFifo.size > 0)
+    #ifdef TRACE_VCP_RX
+    if (RingUsed(&vcpRxFifo) > 0)
     {
-        #ifdef TRACE_VCP_RX
-        log_debug("VCP RX FIFO size: %d/%d", vcpRxFifo.size, vcpRxFifo.maxlen);
-        #endif
+        log_debug("VCP RX ring: %d/%d", RingUsed(&vcpRxFifo), vcpRxFifo.size);
     }
+    #endif
     
-    // Read data from the RX FIFO if available, until we process a full message, then break
-    while (vcpRxFifo.size > 0)
+    // Read data from the RX ring if available, until we process a full message, then break (or until a P25 frame
+    // has to wait for room in the sync TX ring)
+    uint8_t c;
+    while (vcpRxSendHeld() && RingPop(&vcpRxFifo, &c))
     {
         // Turn activity LED on
         #ifdef DVM_V24_V1
@@ -238,14 +535,6 @@ void VCPRxCallback()
         LED_USB_RX(1);
         #endif
 
-        // Read a byte
-        uint8_t c;
-        if (FifoPop(&vcpRxFifo, &c))
-        {
-            log_warn("Tried to pop from empty FIFO, this shouldn't happen!");
-            break;
-        }
-
         vcpRxLastByte = HAL_GetTick();
 
         // If we're waiting for the start of a message, see if we got a message start byte
@@ -323,47 +612,90 @@ void VCPRxCallback()
         // Handle everything else
         else
         {
-            // Make sure message length is valid
+            // This tells us where the command byte is
+            uint8_t offset = 2U;
+            if (vcpRxDoubleLength)
+            {
+                offset = 3U;
+            }
+            // Make sure message length is valid, it has to cover the command byte at least
             if (vcpRxMsgLength > VCP_MAX_MSG_LENGTH_BYTES)
             {
-                log_error("Message length %d is longer than supported!", VCP_MAX_MSG_LENGTH_BYTES);
+                log_error("Message length %d is longer than supported!", vcpRxMsgLength);
+                vcpRxReset();
+                continue;
+            }
+            if (vcpRxMsgLength <= offset)
+            {
+                log_error("Message length %d is too short for a command!", vcpRxMsgLength);
                 vcpRxReset();
+                continue;
+            }
+
+            // P25 payloads are written once, straight into a TX buffer with room for the HDLC header & FCS
+            if (vcpRxMsgPosition >= offset + 2U && vcpRxMsg[offset] == CMD_P25_DATA)
+            {
+                if (vcpRxMsgPosition == offset + 2U)
+                {
+                    vcpRxFrame = TxBufAlloc();
+                }
+                if (vcpRxFrame != NULL && !TxBufPutByte(vcpRxFrame, c))
+                {
+                    log_error("P25 frame too long for a TX buffer, dropping");
+                    TxBufFree(vcpRxFrame);
+                    vcpRxFrame = NULL;
+                }
             }
             // Add any other bytes to the buffer
-            vcpRxMsg[vcpRxMsgPosition] = c;
+            else
+            {
+                if (vcpRxMsgPosition >= VCP_MAX_MSG_LENGTH_BYTES)
+                {
+                    log_error("Message overran the receive buffer!");
+                    vcpRxReset();
+                    continue;
+                }
+                vcpRxMsg[vcpRxMsgPosition] = c;
+            }
             vcpRxMsgPosition++;
 
             // Process message if we've hit our length
             if (vcpRxMsgPosition == vcpRxMsgLength)
             {
-                // This tells us where the command byte is
-                uint8_t offset = 2U;
-                if (vcpRxDoubleLength)
-                {
-                    offset = 3U;
-                }
 
                 #ifdef DEBUG_VCP_RX
                 log_debug("VCP RX: Got DVM message, cmd: $%02X", vcpRxMsg[offset]);
                 #endif
 
+                #ifndef DVM_V24_V1
+                // The host is still talking to us at this rate
+                vcpBaudLastRx = HAL_GetTick();
+                #endif
+
                 // Process command
                 switch (vcpRxMsg[offset])
                 {
                     // Send P25 data as a UI frame
                     case CMD_P25_DATA:
                     {
+                        // Nothing to send if the payload was empty or didn't fit in a buffer
+                        if (vcpRxFrame == NULL)
+                        {
+                            break;
+                        }
                         // Process the UI frame
                         #ifdef DEBUG_VCP_RX
-                        log_debug("Sending UI frame of length %d via HDLC", vcpRxMsgLength - offset - 2U);
+                        log_debug("Sending UI frame of length %d via HDLC", vcpRxFrame->len);
                         #endif
                         #ifdef TRACE_VCP
                         uint8_t hexStrBuf[VCP_MAX_MSG_LENGTH_BYTES * 4U];
-                        HexArrayToStr((char*)hexStrBuf, &vcpRxMsg[offset + 2U], vcpRxMsgLength - offset - 2U);
+                        HexArrayToStr((char*)hexStrBuf, TxBufData(vcpRxFrame), vcpRxFrame->len);
                         log_trace("P25 Frame: %s", hexStrBuf);
                         #endif
-                        // Send the UI, ignoring the first 0x00 byte
-                        HDLCSendUI(vcpRxMsg + offset + 2, vcpRxMsgLength - offset - 2);
+                        // Send the UI (or hold it until there's room), the buffer now belongs to the HDLC layer
+                        vcpRxHeld = vcpRxFrame;
+                        vcpRxFrame = NULL;
+                        vcpRxSendHeld();
                     }
                     break;
                     // Reply to version request
@@ -424,7 +756,7 @@ void VCPRxCallback()
                         #ifdef DEBUG_VCP_RX
                         log_debug("Writing data to flash from serial port");
                         #endif
-                        uint8_t err = flashWrite(vcpRxMsg + 3U, vcpRxMsgLength - 3U);
+                        uint8_t err = flashWrite(vcpRxMsg + offset + 1U, vcpRxMsgLength - offset - 1U);
                         if (err == RSN_OK)
                         {
                             VCPWriteAck(CMD_FLASH_WRITE);
@@ -436,6 +768,76 @@ void VCPRxCallback()
                         }
                     }
                     break;
+                    // Host link baud rate
+                    case CMD_SET_HOST_BAUD:
+                    {
+                        uint32_t baud;
+                        uint8_t err = setHostBaud(vcpRxMsg + offset + 1U, vcpRxMsgLength - offset - 1U, &baud);
+                        if (err == RSN_OK)
+                        {
+                            // The ACK goes out at the old rate, everything after it at the new one. If it couldn't be
+                            // queued the host never hears about the change, so we stay where we are
+                            if (VCPWriteAck(CMD_SET_HOST_BAUD))
+                            {
+                                vcpBaudPending = baud;
+                                vcpBaudSwitchMark = vcpTxFifo.head;
+                            }
+                        }
+                        else
+                        {
+                            log_error("Invalid host baud rate set: %u", err);
+                            VCPWriteNak(CMD_SET_HOST_BAUD, err);
+                        }
+                    }
+                    break;
+                    #endif
+                    // Line rate set
+                    case CMD_SET_LINE_RATE:
+                    {
+                        uint8_t err = setLineRate(vcpRxMsg + offset + 1U, vcpRxMsgLength - offset - 1U);
+                        if (err == RSN_OK)
+                        {
+                            VCPWriteAck(CMD_SET_LINE_RATE);
+                        }
+                        else
+                        {
+                            log_error("Invalid line rate set: %u", err);
+                            VCPWriteNak(CMD_SET_LINE_RATE, err);
+                        }
+                    }
+                    break;
+                    // Line rate & overrun counters
+                    case CMD_GET_LINE_STATUS:
+                        sendLineStatus();
+                    break;
+                    // TX queue depths & drops per traffic class
+                    case CMD_GET_TX_QUEUES:
+                        sendTxQueues();
+                    break;
+                    // SABM to UA & XID to XID reply latencies
+                    case CMD_GET_LINK_LATENCY:
+                        sendLinkLatency();
+                    break;
+                    #ifdef TX_JITTER
+                    // TX jitter buffer depths
+                    case CMD_SET_TX_JITTER:
+                    {
+                        uint8_t err = setTxJitter(vcpRxMsg + offset + 1U, vcpRxMsgLength - offset - 1U);
+                        if (err == RSN_OK)
+                        {
+                            VCPWriteAck(CMD_SET_TX_JITTER);
+                        }
+                        else
+                        {
+                            log_error("Invalid TX jitter depth set: %u", err);
+                            VCPWriteNak(CMD_SET_TX_JITTER, err);
+                        }
+                    }
+                    break;
+                    // TX jitter buffer depths & playout counters
+                    case CMD_GET_TX_JITTER:
+                        sendTxJitter();
+                    break;
                     #endif
                     // Reset MCU
                     case CMD_RESET_MCU:
@@ -453,9 +855,9 @@ void VCPRxCallback()
 
                 #ifdef DEBUG_VCP_RX
                 log_debug("VCP RX msg done!");
-                /*if (vcpRxFifo.size > 0)
+                /*if (RingUsed(&vcpRxFifo) > 0)
                 {
-                    log_debug("Remaining VCP RX FIFO size: %d/%d", vcpRxFifo.size, vcpRxFifo.maxlen);
+                    log_debug("Remaining VCP RX ring: %d/%d", RingUsed(&vcpRxFifo), vcpRxFifo.size);
                 }*/
                 #endif
 
@@ -472,6 +874,23 @@ void VCPRxCallback()
         #endif
     }
 
+    // Let the host send again once there's room
+    #if defined(DVM_V24_V1)
+    if (vcpUsbRxPaused && RingFree(&vcpRxFifo) >= CDC_DATA_FS_MAX_PACKET_SIZE)
+    {
+        vcpUsbRxPaused = false;
+        HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+        CDC_ReceiveResume_FS();
+        HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+    }
+    #elif defined(VCP_HW_FLOW_CONTROL)
+    if (vcpRxPaused && RingFree(&vcpRxFifo) >= VCP_RX_BUF_LEN / 2U)
+    {
+        vcpRxPaused = false;
+        ATOMIC_SET_BIT(huart1.Instance->CR3, USART_CR3_DMAR);
+    }
+    #endif
+
     // Timeout and reset if we haven't received a full message
     if ((vcpRxMsgPosition > 0) && (HAL_GetTick() - vcpRxLastByte > VCP_RX_TIMEOUT))
     {
@@ -494,97 +913,90 @@ void VCPRxCallback()
 void VCPTxCallback()
 {  
     #ifdef DVM_V24_V1
-    // On V1, since we use USB, we don't have a CPLT callback and clear these here
-    if (txPos > 0)
-    {
-        memset(txBuffer, 0x00U, VCP_MAX_MSG_LENGTH_BYTES);
-        txPos = 0;
-    }
-    #else
-    // On V2, everything is cleared by the complete callback so we just check if we're currently transmitting
-    if (usartTx)
+    // Transfers are chained from the transmit complete callback, so only kick one off if the endpoint is idle
+    if (vcpUsbTxBytes > 0U || RingUsed(&vcpTxFifo) == 0U)
     {
         return;
     }
-    usartTxStart = HAL_GetTick();
-    #endif
-
-    // Write any bytes in the VCP TX queue
-    while (vcpTxFifo.size > 0)
+    // Don't leave anything queued for whoever opens the port next
+    if (!USB_VCP_DTR)
     {
-        // Read a byte
-        uint8_t c;
-        if (FifoPop(&vcpTxFifo, &c))
-        {
-            log_warn("Tried to pop from empty TX FIFO, this shouldn't happen!");
-            break;
-        }
-
-        // Add to the buffer
-        txBuffer[txPos] = c;
-        txPos++;
+        log_error("USB VCP disconnected, dropping %u bytes", RingUsed(&vcpTxFifo));
+        RingClear(&vcpTxFifo);
+        return;
     }
+    // The USB interrupt starts transfers too, so keep it out while we do
+    HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+    vcpUsbTxStart();
+    HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+    #else
 
-    // Return if we didn't get any bytes
-    if (txPos == 0)
+    // Report a slow transfer flagged by the TX complete interrupt
+    if (vcpTxSlowMs)
     {
-        return;
+        log_error("VCP USART TX routine took %lu ms!", vcpTxSlowMs);
+        VCPWriteDebug1("VCP USART TX routine took > " STR(VCP_TX_TIMEOUT) "ms");
+        vcpTxSlowMs = 0;
     }
 
-    #ifdef DVM_V24_V1
-    
-    // Directly write to the VCP
-    bool sent = false;
-    uint8_t attempts = USB_TX_RETRIES;
-    while (attempts > 0)
+    // While a baud rate change is waiting, only what was queued up to its ACK goes out at the old rate
+    uint16_t txMax = VCP_MAX_MSG_LENGTH_BYTES;
+    if (vcpBaudPending)
     {
-        // Break if USB port is closed
-        if (!USB_VCP_DTR)
+        uint16_t before = vcpBaudSwitchMark - vcpTxFifo.tail;
+        // (the ring was flushed past the mark)
+        if (before > RingUsed(&vcpTxFifo))
         {
-            log_error("USB VCP disconnected, dropping message");
-            return;
+            before = 0U;
         }
-        // Try to send
-        LED_USB(1);
-        // We have to disable the USB interrupts when using CDC_Transmit_FS, apparently
-        HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
-        uint8_t rtn = CDC_Transmit_FS(txBuffer, txPos);
-        HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
-        attempts--;
-        LED_USB(0);
-        // Check for success
-        if (rtn == USBD_OK)
+        if (before < txMax)
         {
-            sent = true;
-            break;
+            txMax = before;
         }
-        else
+        // Switch once that's all been sent
+        if (before == 0U && !usartTx && vcpTxDmaLen[0] == 0U && vcpTxDmaLen[1] == 0U)
         {
-            log_warn("USB TX returned %d, retrying %d/%d", rtn, attempts, USB_TX_RETRIES);
+            log_info("Host link moving to %lu baud", vcpBaudPending);
+            vcpSetBaud(vcpBaudPending);
+            vcpBaudPending = 0U;
         }
     }
-    if (!sent)
+    // Fall back to the default rate if the host doesn't talk to us at the new one (or stops)
+    else if (vcpBaud != VCP_BAUD_DEFAULT && !usartTx && HAL_GetTick() - vcpBaudLastRx > VCP_BAUD_FALLBACK_TIMEOUT)
     {
-        log_error("Failed to write to USB port");
+        log_warn("Nothing from the host at %lu baud, falling back to %lu", vcpBaud, VCP_BAUD_DEFAULT);
+        vcpSetBaud(VCP_BAUD_DEFAULT);
     }
-    #else
 
-    // Turn LED on (turned off by TX cplt callback)
-    LED_USB_TX(1);
-
-    // Set flag
-    usartTx = true;
-
-    // Write to USART1
-    //HAL_UART_Transmit_DMA(&huart1, txBuffer, txPos);
-    //HAL_UART_Transmit(&huart1, txBuffer, txPos, VCP_TX_TIMEOUT);
-    HAL_UART_Transmit_IT(&huart1, txBuffer, txPos);
-
-    #ifdef DEBUG_VCP_TX
-    log_debug("Sent %u-byte message to VCP TX DMA", txPos);
-    #endif
+    // Pack the free buffer with whatever whole messages are waiting. The one being sent is left alone until the TX
+    // complete interrupt frees it, and the buffers are always filled & sent in turn so messages stay in order
+    if (vcpTxDmaLen[vcpTxFill] == 0U)
+    {
+        uint16_t len = vcpTxPack(vcpTxDmaBuf[vcpTxFill], txMax);
+        if (len > 0U)
+        {
+            // The buffer has to be filled before the interrupt can see its length
+            __DMB();
+            vcpTxDmaLen[vcpTxFill] = len;
+            vcpTxFill ^= 1U;
+            #ifdef DEBUG_VCP_TX
+            log_debug("Packed %u bytes for VCP TX DMA", len);
+            #endif
+        }
+    }
 
-    //VCPTxComplete();
+    // Start a transfer if the link is idle, otherwise the TX complete interrupt picks up the packed buffer
+    if (!usartTx && vcpTxDmaLen[vcpTxSend] > 0U)
+    {
+        // Turn LED on (turned off by TX cplt callback)
+        LED_USB_TX(1);
+        usartTx = true;
+        if (!vcpTxStartDma())
+        {
+            LED_USB_TX(0);
+            usartTx = false;
+        }
+    }
 
     #endif
 }
@@ -608,15 +1020,11 @@ bool VCPWrite(uint8_t *data, uint16_t len)
     }
     #endif
 
-    // Add to TX fifo
-    for (int i = 0; i < len; i++)
+    // Add to TX ring, whole messages only so the host never sees half of one
+    if (!RingWrite(&vcpTxFifo, data, len))
     {
-        if (FifoPush(&vcpTxFifo, data[i]))
-        {
-            log_error("VCP TX FIFO full! Clearing");
-            FifoClear(&vcpTxFifo);
-            return false;
-        }
+        log_error("VCP TX ring full! Dropping %u-byte message", len);
+        return false;
     }
 
     return true;
@@ -670,25 +1078,45 @@ bool VCPWriteNak(uint8_t cmd, uint8_t err)
 */
 bool VCPWriteP25Frame(const uint8_t *data, uint16_t len)
 {
-    // Start byte, length byte, cmd byte, and a 0x00 pad to maintain dvm compliance
-    uint8_t buffer[VCP_MAX_MSG_LENGTH_BYTES];
-    buffer[0] = DVM_SHORT_FRAME_START;
-    buffer[1] = (uint8_t)len + 4;
-    buffer[2] = CMD_P25_DATA;
-    buffer[3] = 0x00;
-
-    memcpy(buffer + 4, data, len);
+    // Start byte, length byte(s), cmd byte, and a 0x00 pad to maintain dvm compliance
+    uint8_t header[5];
+    uint8_t headerLen;
+    uint16_t msgLen = len + 4U;
+    if (msgLen <= 0xFFU)
+    {
+        header[0] = DVM_SHORT_FRAME_START;
+        header[1] = (uint8_t)msgLen;
+        headerLen = 2U;
+    }
+    else
+    {
+        // Frames too long for a single length byte use the long frame format
+        msgLen++;
+        header[0] = DVM_LONG_FRAME_START;
+        header[1] = (uint8_t)(msgLen >> 8);
+        header[2] = (uint8_t)msgLen;
+        headerLen = 3U;
+    }
+    header[headerLen++] = CMD_P25_DATA;
+    header[headerLen++] = 0x00;
 
     #ifdef DEBUG_VCP_TX
     log_debug("Writing P25 frame of length %d to VCP", len);
     #endif
     #ifdef TRACE_VCP
     uint8_t hexStrBuf[VCP_MAX_MSG_LENGTH_BYTES * 4];
-    printHexArray((char*)hexStrBuf, buffer, len+3);
+    printHexArray((char*)hexStrBuf, (uint8_t*)data, len);
     log_trace("Sending %s", hexStrBuf);
     #endif
 
-    return VCPWrite(buffer, len+4);
+    // The payload goes straight into the TX ring after the header instead of being copied into a message buffer first,
+    // so check there's room for both so the header can't go out on its own
+    if (RingFree(&vcpTxFifo) < headerLen + len)
+    {
+        log_error("VCP TX ring full! Dropping %u-byte P25 frame", len);
+        return false;
+    }
+    return VCPWrite(header, headerLen) && VCPWrite((uint8_t*)data, len);
 }
 
 /**
@@ -730,8 +1158,8 @@ void sendVersion()
 */
 void sendStatus()
 {
-    uint8_t reply[15U];
-    memset(reply, 0x00U, 15U);
+    uint8_t reply[12U];
+    memset(reply, 0x00U, 12U);
 
     // Frame start stuff
     reply[0U] = DVM_SHORT_FRAME_START;
@@ -750,38 +1178,226 @@ void sendStatus()
     // Report P25 mode always
     reply[4U] = STATE_P25;
 
-    // Calculate free space in the VCP RX FIFO
     #ifdef STATUS_SPACE_BLOCKS
     // Flag if we're reporting in 16-byte blocks
     reply[3U] |= 0x80U;
-    uint8_t framesFree = (vcpRxFifo.maxlen - vcpRxFifo.size) / 16U;
-    #else
-    uint8_t framesFree = (vcpRxFifo.maxlen - vcpRxFifo.size) / P25_V24_LDU_FRAME_LENGTH_BYTES;  
-    #endif
-    
-    // Reset buffers if we get low
-    #ifdef STATUS_SPACE_BLOCKS
-    if (framesFree < 16U)
-    #else
-    if (framesFree < 1U)
     #endif
-    {
-        log_error("TX buffer low: %d / %d bytes used, resetting buffer", vcpRxFifo.size, vcpRxFifo.maxlen);
-        VCPWriteDebug3("TX buffer low, clearing. Bytes Free/Total: ", vcpRxFifo.size, vcpRxFifo.maxlen);
-        FifoClear(&vcpRxFifo);
-    }
 
-    // Report free space in the VCP buffer (since that's the main one we care about)
-    //reply[10U] = SyncGetTxFree();
-    reply[10U] = framesFree;
+    // Report how much more the host can send, allowing for everything between it and the V24 line
+    reply[10U] = vcpStatusSpace();
 
-    VCPWrite(reply, 15U);
+    VCPWrite(reply, 12U);
 
     /*#ifdef TRACE_VCP
     log_trace("Sent DVM status information");
     #endif*/
 }
 
+/**
+ * @brief Write a 32 bit value big-endian into a reply buffer
+*/
+static void putUint32(uint8_t *buf, uint32_t value)
+{
+    buf[0U] = (value >> 24) & 0xFFU;
+    buf[1U] = (value >> 16) & 0xFFU;
+    buf[2U] = (value >> 8) & 0xFFU;
+    buf[3U] = value & 0xFFU;
+}
+
+/**
+ * @brief Change the V24 line rate
+ * 
+ * @param data payload, the rate in bps as a 32 bit big-endian value
+ * @param length length of the payload
+ * @return uint8_t return reason
+ */
+uint8_t setLineRate(const uint8_t* data, uint16_t length)
+{
+    if (length != 4U)
+    {
+        return RSN_ILLEGAL_LENGTH;
+    }
+
+    uint32_t rate = 
+        ((uint32_t)data[0U] << 24) +
+        ((uint32_t)data[1U] << 16) +
+        ((uint32_t)data[2U] << 8) +
+        (uint32_t)data[3U];
+
+    if (!SyncSetLineRate(rate))
+    {
+        return RSN_INVALID_REQUEST;
+    }
+    return RSN_OK;
+}
+
+#ifndef DVM_V24_V1
+/**
+ * @brief Handle a host link baud rate set command, with the new rate as a 32-bit big-endian payload
+ * 
+ * Only validates the rate, the caller switches once the ACK has been sent. The host has to send something at the new rate within
+ * VCP_BAUD_FALLBACK_TIMEOUT (and keep doing so), otherwise we go back to VCP_BAUD_DEFAULT
+ * 
+ * @param data payload
+ * @param length payload length
+ * @param baud set to the requested rate if it's valid
+ * @return RSN_OK, or the reason to NAK
+*/
+uint8_t setHostBaud(const uint8_t* data, uint16_t length, uint32_t *baud)
+{
+    if (length != 4U)
+    {
+        return RSN_ILLEGAL_LENGTH;
+    }
+
+    uint32_t rate = 
+        ((uint32_t)data[0U] << 24) +
+        ((uint32_t)data[1U] << 16) +
+        ((uint32_t)data[2U] << 8) +
+        (uint32_t)data[3U];
+
+    // Rates the CP2102 supports that USART1 can hit within 0.2% from its 72 MHz clock
+    if (rate != 115200U && rate != 230400U && rate != 460800U && rate != 921600U)
+    {
+        return RSN_INVALID_REQUEST;
+    }
+    *baud = rate;
+    return RSN_OK;
+}
+#endif
+
+/**
+ * @brief Send the current line rate, sync engine overrun counters and RX DPLL statistics
+ * 
+ * Nonzero overrun counters mean the sync engine isn't keeping up at the current line rate. The DPLL
+ * statistics are only counted with SYNC_RX_OVERSAMPLE enabled.
+*/
+void sendLineStatus()
+{
+    uint8_t reply[35U];
+
+    reply[0U] = DVM_SHORT_FRAME_START;
+    reply[1U] = 35U;
+    reply[2U] = CMD_GET_LINE_STATUS;
+
+    putUint32(reply + 3U, SyncGetLineRate());
+    putUint32(reply + 7U, syncTimerOverruns);
+    putUint32(reply + 11U, syncRxOverruns);
+    putUint32(reply + 15U, syncTxOverruns);
+    putUint32(reply + 19U, syncDpllTransitions);
+    putUint32(reply + 23U, syncDpllAhead);
+    putUint32(reply + 27U, syncDpllBehind);
+    putUint32(reply + 31U, syncDpllErrSum);
+
+    VCPWrite(reply, 35U);
+}
+
+/**
+ * @brief Send the TX queue depth, and the counts of frames queued & dropped, of each traffic class
+ * 
+ * For each of voice, stream records, TSBK and data in turn: the frames waiting (one byte), then 32 bit counts of
+ * frames queued and dropped. Voice drops are the jitter buffer's early frames.
+*/
+void sendTxQueues()
+{
+    uint8_t reply[3U + TXQ_CLASSES * 9U];
+
+    reply[0U] = DVM_SHORT_FRAME_START;
+    reply[1U] = sizeof(reply);
+    reply[2U] = CMD_GET_TX_QUEUES;
+
+    for (uint8_t cls = 0; cls < TXQ_CLASSES; cls++)
+    {
+        uint8_t *entry = reply + 3U + cls * 9U;
+        uint32_t drops = txqDrops[cls];
+        #ifdef TX_JITTER
+        if (cls == TXQ_VOICE)
+        {
+            drops = jitterEarly;
+        }
+        #endif
+        entry[0U] = TxqGetDepth(cls);
+        putUint32(entry + 1U, txqQueued[cls]);
+        putUint32(entry + 5U, drops);
+    }
+
+    VCPWrite(reply, sizeof(reply));
+}
+
+/**
+ * @brief Send the request to reply latencies of the link control exchanges
+ * 
+ * For SABM to UA, then XID to XID: 32 bit counts of replies timed, then the last, worst and average latency in ms,
+ * from the request coming in to the whole reply having gone out on the line
+*/
+void sendLinkLatency()
+{
+    uint8_t reply[3U + HDLC_LAT_TYPES * 16U];
+
+    reply[0U] = DVM_SHORT_FRAME_START;
+    reply[1U] = sizeof(reply);
+    reply[2U] = CMD_GET_LINK_LATENCY;
+
+    for (uint8_t i = 0; i < HDLC_LAT_TYPES; i++)
+    {
+        const HdlcLatency_t *lat = &hdlcLatency[i];
+        uint8_t *entry = reply + 3U + i * 16U;
+        putUint32(entry, lat->count);
+        putUint32(entry + 4U, lat->last);
+        putUint32(entry + 8U, lat->max);
+        putUint32(entry + 12U, lat->count ? lat->sum / lat->count : 0U);
+    }
+
+    VCPWrite(reply, sizeof(reply));
+}
+
+#ifdef TX_JITTER
+/**
+ * @brief Change the TX jitter buffer target & maximum depth
+ * 
+ * @param data payload, the target and maximum depth in voice frames (one byte each)
+ * @param length length of the payload
+ * @return uint8_t return reason
+ */
+uint8_t setTxJitter(const uint8_t* data, uint16_t length)
+{
+    if (length != 2U)
+    {
+        return RSN_ILLEGAL_LENGTH;
+    }
+    if (!JitterSetDepth(data[0U], data[1U]))
+    {
+        return RSN_INVALID_REQUEST;
+    }
+    return RSN_OK;
+}
+
+/**
+ * @brief Send the TX jitter buffer depths and playout counters
+ * 
+ * The configured target & maximum, the target in use (raised after underruns), and the voice frames waiting,
+ * then 32 bit counts of voice frames played, late frames, early (dropped) frames and voice slots sent as flags
+*/
+void sendTxJitter()
+{
+    uint8_t reply[23U];
+
+    reply[0U] = DVM_SHORT_FRAME_START;
+    reply[1U] = 23U;
+    reply[2U] = CMD_GET_TX_JITTER;
+
+    JitterGetDepth(&reply[3U], &reply[4U]);
+    reply[5U] = jitterTarget;
+    reply[6U] = JitterGetVoice();
+    putUint32(reply + 7U, jitterPlayed);
+    putUint32(reply + 11U, jitterLate);
+    putUint32(reply + 15U, jitterEarly);
+    putUint32(reply + 19U, jitterUnderruns);
+
+    VCPWrite(reply, 23U);
+}
+#endif
+
 #ifndef DVM_V24_V1
 
 /**
@@ -808,7 +1424,7 @@ void flashRead()
  * @param length length of data to write
  * @return uint8_t return reason
  */
-uint8_t flashWrite(const uint8_t* data, uint8_t length)
+uint8_t flashWrite(const uint8_t* data, uint16_t length)
 {
     if (length > 249U)
     {